@@ -1,57 +1,128 @@
 #include "compiler-base.h"
+#include "compiler-token-stream.h"
 
 using namespace compiler;
 
 compiler_exception::compiler_exception(const token& token, std::string msg) : line(token.line), character(token.character), msg(msg), pos_available(true) {}
 
-std::optional<variable_identifier*> compiler::variable_scope::search(const std::string& identifier)
-{
-	auto search = this;
-
-	while (1)
-	{
-		auto find = search->map.find(identifier);
-		if (find == search->map.end())
-		{
-			if (search->parent)
-			{
-				search = search->parent; // һ
-				continue;
-			}
-			else
-				return std::nullopt; // ޽
-		}
-		else
-			return &find->second;
-	}
+compiler_exception::compiler_exception(const token_view& token, std::string msg) : msg(msg), pos_available(true)
+{
+    std::tie(line, character) = token.position();
 }
 
-number_union compiler::token::get_negative_val() const
+symbol_id compiler::symbol_interner::intern(std::string_view name)
+{
+    auto [iter, inserted] = lut.try_emplace(name, symbol_id(names.size()));
+    if (inserted) names.push_back(name);
+
+    return iter->second;
+}
+
+void compiler::bracket_table::push(token_type type)
+{
+    const uint32_t index = uint32_t(match.size());
+    match.push_back(no_match);
+
+    auto close = [&](std::vector<uint32_t>& open)
+    {
+        if (open.empty()) return; // 
+
+        match[open.back()] = index;
+        match[index] = open.back();
+        open.pop_back();
+    };
+
+    switch (type)
+    {
+    case token_type::left_bracket:
+        open_brackets.push_back(index);
+        break;
+
+    case token_type::right_bracket:
+        close(open_brackets);
+        break;
+
+    case token_type::left_parentheses:
+        open_parentheses.push_back(index);
+        break;
+
+    case token_type::right_parentheses:
+        close(open_parentheses);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void compiler::symbol_table::exit()
 {
-    if (type == token_type::number)
+    const uint32_t mark = marks.back();
+    marks.pop_back();
+
+    // 
+    for (size_t i = records.size(); i > mark; i--)
+    {
+        const auto& record = records[i - 1];
+        visible[record.name] = record.previous;
+    }
+
+    records.erase(records.begin() + mark, records.end());
+}
+
+bool compiler::symbol_table::declare(symbol_id name, variable_index variable)
+{
+    if (name >= visible.size()) visible.resize(size_t(name) + 1);
+
+    auto& bind = visible[name];
+    const uint32_t mark = marks.empty() ? 0 : marks.back();
+
+    if (bind.variable != invalid_variable && bind.record >= mark)
+        return false; // ǰ
+
+    records.push_back({ name, bind });
+    bind = { variable, uint32_t(records.size() - 1) };
+    return true;
+}
+
+// ȡtoken  token_view ãλýڱʱ
+template<class token_like>
+static number_union negative_val(const token_like& t)
+{
+    if (t.type == token_type::number)
     {
         number_union temp;
 
-        switch (number_type)
+        switch (t.number_type)
         {
         case number_type::float_point:
-            temp.fp_number = -number_data.fp_number;
+            temp.fp_number = -t.number_data.fp_number;
             return temp;
 
         case number_type::integer:
-            temp.int_number = -number_data.int_number;
+            temp.int_number = -t.number_data.int_number;
             return temp;
 
         case number_type::unsigned_integer:
-            throw compiler_exception(line, character,
+            throw compiler_exception(t,
                 "Can't apply negative operand to an unsigned integer.");
 
         default:
-            throw compiler_exception(line, character,
+            throw compiler_exception(t,
                 "No negative operand available for this token. This is an internal error/bug.");
         }
     }
     else
-        throw compiler_exception(line, character,
+        throw compiler_exception(t,
             "Can't apply negative operand to this token.");
 }
+
+number_union compiler::token::get_negative_val() const
+{
+    return negative_val(*this);
+}
+
+number_union compiler::token_view::get_negative_val() const
+{
+    return negative_val(*this);
+}
\ No newline at end of file
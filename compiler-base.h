@@ -8,6 +8,7 @@ namespace compiler
 {
     struct compiler_exception;
     struct token;
+    struct token_view;
     struct variable_identifier;
     struct node_value;
     struct assignment;
@@ -22,10 +23,11 @@ namespace compiler
         compiler_exception(size_t line, size_t character, std::string msg = "") : line(line), character(character), msg(msg), pos_available(true) {}
         compiler_exception(std::string msg) : line(0), character(0), msg(msg), pos_available(false) {}
         compiler_exception(const token& token, std::string msg = "");
+        compiler_exception(const token_view& token, std::string msg = "");
     };
 
     // 操作符类型
-    enum class operand_type
+    enum class operand_type : uint8_t
     {
         none = 0,
         add, // ‘+’
@@ -51,7 +53,7 @@ namespace compiler
     };
 
     // 关键词类型
-    enum class keyword_type
+    enum class keyword_type : uint8_t
     {
         none = 0,
         kw_while,
@@ -64,11 +66,8 @@ namespace compiler
         kw_else
     };
 
-    // 关键词查找表
-    extern const std::unordered_map<std::string, keyword_type> keyword_lut;
-
     // 数据类型
-    enum class number_type
+    enum class number_type : uint8_t
     {
         none = 0,
         integer, // 有符号32位整形
@@ -76,8 +75,32 @@ namespace compiler
         float_point // 32位浮点
     };
 
-    // 数据类型查找表
-    extern const std::unordered_map<std::string, number_type> number_type_lut;
+    /* 符号驻留 */
+
+    // 符号编号
+    typedef uint32_t symbol_id;
+
+    // 符号驻留表：每个不同的标识符在词法分析时分配一次小整数编号，此后按编号比较与哈希
+    // 名称引用源码，源码须在驻留表使用期间保持有效
+    struct symbol_interner
+    {
+        std::unordered_map<std::string_view, symbol_id> lut; // 名称 -> 编号
+        std::vector<std::string_view> names; // 编号 -> 名称
+
+    public:
+        // 驻留名称，返回其编号
+        symbol_id intern(std::string_view name);
+
+        inline std::string_view name(symbol_id id) const
+        {
+            return names.at(id);
+        }
+
+        inline size_t size() const
+        {
+            return names.size();
+        }
+    };
 
     /* 词元分析器 */
 
@@ -107,8 +130,8 @@ namespace compiler
         separator, // 逗号
     };
 
-    // 词元
-    struct token
+    // 词元公共部分：类别、常量数据与匹配
+    struct token_base
     {
         bool white_space = false;
         token_type type = token_type::unknown; // 大类别
@@ -121,18 +144,11 @@ namespace compiler
             number_type number_type;
         };
 
-        std::string literal;
-
         number_union number_data;
 
-        size_t line = 0, character = 0;
+        symbol_id symbol = 0; // 标识符的符号编号
 
     public:
-        token() = default;
-
-        // 提取负数
-        number_union get_negative_val() const;
-
         // 匹配
         inline bool match(const operand_type target) const
         {
@@ -152,51 +168,126 @@ namespace compiler
         }
     };
 
+    // 词元
+    struct token : public token_base
+    {
+        std::string_view literal; // 引用源码
+
+        size_t line = 0, character = 0;
+
+    public:
+        token() = default;
+
+        // 提取负数
+        number_union get_negative_val() const;
+    };
+
     // 词元列表
     typedef std::vector<token> token_list; 
 
+    // 括号匹配表：按词元编号记录与之配对的括号的词元编号，{} 与 () 分别配对
+    // 由词法分析器随词元依次记录，非括号词元与未配对的括号为 no_match；解析器借此 O(1) 跳过暂不解析的函数体与出错同步时途经的语句块
+    struct bracket_table
+    {
+        static constexpr uint32_t no_match = UINT32_MAX;
+
+        std::vector<uint32_t> match;
+
+        // 记录过程中尚未配对的左括号
+        std::vector<uint32_t> open_brackets;
+        std::vector<uint32_t> open_parentheses;
+
+    public:
+        // 记录下一个词元
+        void push(token_type type);
+
+        inline uint32_t operator[](size_t index) const
+        {
+            return index < match.size() ? match[index] : no_match;
+        }
+    };
+
     /* 语法树 */
 
     // 变量
     struct variable_identifier
     {
         bool global = false; // 全局或临时变量
-        std::string name;
+        symbol_id name = 0;
         number_type val_type = number_type::none; // 变量类型
         size_t mem_alloc = SIZE_MAX; // 寄存器/内存位置
 
     public:
         variable_identifier() = default;
-        variable_identifier(std::string name, number_type val_type, bool global = false) : name(name), val_type(val_type), global(global) {}
+        variable_identifier(symbol_id name, number_type val_type, bool global = false) : name(name), val_type(val_type), global(global) {}
         ~variable_identifier() = default;
     };
 
-    // 变量空间
-    struct variable_scope
+    // 语法树节点编号：节点在 syntax_tree::nodes 中的下标
+    using node_index = uint32_t;
+    constexpr node_index invalid_node = std::numeric_limits<node_index>::max();
+
+    // 语句编号：语句在所属类别数组中的下标
+    using statement_index = uint32_t;
+    constexpr statement_index invalid_statement = std::numeric_limits<statement_index>::max();
+
+    // 变量编号：变量在 syntax_tree::variables 中的下标
+    using variable_index = uint32_t;
+    constexpr variable_index invalid_variable = std::numeric_limits<variable_index>::max();
+
+    // 作用域符号表：全部作用域共用一张表，按符号编号直接取得当前可见的变量，查找与嵌套深度无关
+    // 被遮蔽的同名变量记入声明记录，构成每个名称各自的遮蔽栈；进入作用域只记下标记，退出时撤销本层的声明，不声明变量的作用域不占空间
+    struct symbol_table
     {
-        variable_scope* parent = nullptr; // 上级变量空间
-        std::unordered_map<std::string, variable_identifier> map;
+        // 名称当前绑定的变量，及该绑定对应的声明记录
+        struct binding
+        {
+            variable_index variable = invalid_variable;
+            uint32_t record = 0;
+        };
+
+        // 声明记录：声明的名称与被其遮蔽的绑定
+        struct shadow_record
+        {
+            symbol_id name = 0;
+            binding previous;
+        };
+
+        std::vector<binding> visible; // 按符号编号索引
+        std::vector<shadow_record> records;
+        std::vector<uint32_t> marks; // 各层作用域在 records 中的起点
 
     public:
-        variable_scope() = default;
-        variable_scope(variable_scope* parent) : parent(parent) {}
+        // 进入作用域
+        inline void enter()
+        {
+            marks.push_back(uint32_t(records.size()));
+        }
 
-        ~variable_scope() = default;
+        // 退出作用域，恢复被本层声明遮蔽的变量
+        void exit();
 
-        // 搜索变量
-        std::optional<variable_identifier*> search(const std::string& identifier);
+        // 在当前作用域声明变量，当前作用域已有同名变量时返回 false
+        bool declare(symbol_id name, variable_index variable);
 
-        // 插入变量
-        inline void add_identifier(const variable_identifier& id)
+        // 查找名称当前可见的变量，无则返回 invalid_variable
+        inline variable_index find(symbol_id name) const
         {
-            map.insert(std::make_pair(id.name, id));
+            return name < visible.size() ? visible[name].variable : invalid_variable;
         }
     };
 
-    // 数值节点
+    // 源码位置：行号与列号，与词元的 line、character 相同
+    struct source_position
+    {
+        uint32_t line = 0, character = 0;
+    };
+
+    // 数值节点，16字节
+    // 子节点总在父节点之前创建，一棵子树占据 nodes 中以根结尾的连续区间
     struct node_value
     {
-        enum type
+        enum type : uint8_t
         {
             node_invalid,
             node_operator,
@@ -207,113 +298,171 @@ namespace compiler
 
         type node_type = node_invalid;
 
-        std::string identifier;
-        number_union value;
-
         union
         {
             operand_type op_type;
             number_type number_type = number_type::none;
-            variable_identifier* val_identifier;
         };
 
-        node_value* left = nullptr;
-        node_value* right = nullptr;
+        union
+        {
+            number_union value; // 常量
+            symbol_id identifier; // 标识符/函数名
+        };
 
-        std::vector<node_value*> parameter_list; // 函数参数列表
+        // 运算符：左右子节点
+        // 函数：left 为首个参数在 syntax_tree::parameters 中的位置，right 为参数个数
+        // 标识符：left 为名称解析得到的变量在 syntax_tree::variables 中的编号，解析前为 invalid_node；right 为其位置在 syntax_tree::identifier_positions 中的下标
+        node_index left = invalid_node;
+        node_index right = invalid_node;
 
     public:
-        node_value() = default;
-
-        ~node_value()
-        {
-            if (left) delete left;
-            if (right) delete right;
-            for (auto para : parameter_list) delete para;
-        }
+        node_value() : identifier(0) {}
     };
 
+    static_assert(sizeof(node_value) == 16, "node_value should stay 16 bytes");
+
     struct declarement
     {
         number_type type;
-        std::string name;
+        symbol_id name;
+        variable_index variable = invalid_variable; // 名称解析时创建的变量
+        source_position position; // 变量名的位置
     };
     
     // 赋值语句
     struct assignment
     {
-        enum variable_type
+        enum variable_type : uint8_t
         {
             ram_address, // 内存地址
             variable // 变量
         };
 
-        node_value* right = nullptr; // 右值
+        node_index right = invalid_node; // 右值
         variable_type type = ram_address; // 左值类型
         
         union
         {
-            node_value* left = nullptr;
-            std::string var_name;
+            node_index left = invalid_node;
+            symbol_id var_name;
         };
 
-    public:
-        assignment() = default;
+        variable_index var_index = invalid_variable; // 左值为变量时，名称解析得到的变量
+        source_position position; // 左值为变量时，变量名的位置
+    };
+
+    //== 语句包裹结构体 ==
 
-        ~assignment()
+    struct statement_wrapper
+    {
+        enum type : uint8_t // 语句类型
         {
-            if (right) delete right;
-            if (type == ram_address) if (left) delete left;
-            else var_name.~basic_string();
-        }
-    };
+            none,
+            decl, // 声明语句
+            assign, // 赋值语句
+            if_statement, // if 语句
+            while_loop,
+            return_statement // 返回语句
+        } 
+        statement_type = none;
 
-    struct statement_wrapper;
+        statement_index index = invalid_statement; // 在对应类别数组中的位置；返回语句为返回值的节点编号，无返回值时为 invalid_node
 
-    //== 语句包裹结构体 ==
+        statement_wrapper() = default;
+        statement_wrapper(type t, statement_index index) : statement_type(t), index(index) {}
+    };
+
+    // 语句块：syntax_tree::statements 中的连续区间
+    struct statement_range
+    {
+        uint32_t begin = 0;
+        uint32_t count = 0;
+    };
 
     // if 分支
     struct if_branch
     {
-        node_value* condition = nullptr;
-        variable_scope var_scope; // 主体部分变量空间
-        std::optional<variable_scope> else_var_scope = std::nullopt; // else部分变量空间
-        std::vector<statement_wrapper> body; // 语句主体
-        std::vector<statement_wrapper> else_body;
-
-    public:
-        if_branch() = default;
+        node_index condition = invalid_node;
+        statement_range body; // 语句主体
+        statement_range else_body; // 无 else 时为空
     };
 
     // while 循环
     struct while_loop
     {
-        node_value* condition;
-        variable_scope var_scope;
-        std::vector<statement_wrapper> body;
+        node_index condition = invalid_node;
+        statement_range body;
     };
 
-    struct statement_wrapper
+    // 函数定义：函数体在首次需要时才解析
+    struct function_definition
+    {
+        symbol_id name = 0;
+        number_type return_type = number_type::none; // 无返回值时为 none
+        statement_range parameters; // 形参在 declarements 中的区间
+
+        uint32_t body_token = 0; // 函数体左花括号的词元编号
+        bool parsed = false;
+
+        // 以下在 parsed 为真时有效
+        statement_range body;
+        node_index node_begin = 0, node_end = 0; // 函数体内的节点在 nodes 中的区间
+    };
+
+    // 扁平语法树：节点与各类语句分别存放于连续数组，相互以32位下标引用
+    struct syntax_tree
     {
-        enum type // 语句类型
+        std::vector<node_value> nodes;
+        std::vector<node_index> parameters; // 函数参数，每次调用占一段连续区间
+        std::vector<source_position> identifier_positions; // 标识符节点的位置，供名称解析报告错误
+        std::vector<variable_identifier> variables; // 名称解析时创建的变量，标识符节点的 left 为其编号
+
+        std::vector<statement_wrapper> statements; // 各语句块的语句连续存放
+        std::vector<declarement> declarements;
+        std::vector<assignment> assignments;
+        std::vector<if_branch> branches;
+        std::vector<while_loop> loops;
+        std::vector<function_definition> functions;
+
+        statement_range globals; // 全局声明
+
+    public:
+        inline node_value& operator[](node_index index) { return nodes[index]; }
+        inline const node_value& operator[](node_index index) const { return nodes[index]; }
+
+        inline node_index add_node(const node_value& node)
         {
-            none,
-            decl, // 声明语句
-            assign, // 赋值语句
-            if_statement, // if 语句
-            while_loop
-        } 
-        statement_type = none;
+            nodes.push_back(node);
+            return node_index(nodes.size() - 1);
+        }
 
-        union
+        // 函数节点的参数
+        inline std::span<const node_index> parameters_of(node_index function) const
         {
-            void* ptr = nullptr;
-            declarement* decl_ptr;
-            assignment* assignment_ptr;
-            if_branch* if_ptr;
-        };
+            const auto& node = nodes[function];
+            return std::span<const node_index>(parameters.data() + node.left, node.right);
+        }
 
-        statement_wrapper() = default;
-        statement_wrapper(type t, void* ptr): statement_type(t), ptr(ptr){}
+        // 以 root 为根的子树在 nodes 中的起点，子树即 [subtree_begin(root), root]；共享子表达式时子树还可引用同一语句中更早的节点
+        inline node_index subtree_begin(node_index root) const
+        {
+            while (1)
+            {
+                const auto& node = nodes[root];
+
+                if (node.node_type == node_value::node_operator)
+                    root = node.left;
+                else if (node.node_type == node_value::node_function && node.right != 0)
+                    root = parameters[node.left];
+                else
+                    return root;
+            }
+        }
+
+        inline std::span<const statement_wrapper> block(statement_range range) const
+        {
+            return std::span<const statement_wrapper>(statements.data() + range.begin, range.count);
+        }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,80 @@
+// compiler-constant-folding.cpp: 带类型的常量折叠
+
+#include "compiler-constant-folding.h"
+
+using namespace compiler;
+using namespace compiler::constant_folding;
+
+number_type compiler::constant_folding::common_type(number_type left, number_type right)
+{
+	if (left == number_type::none || right == number_type::none) return number_type::none;
+	return std::max(left, right); // 枚举按 integer < unsigned_integer < float_point 排列
+}
+
+constant compiler::constant_folding::convert(constant value, number_type type)
+{
+	if (value.type == type) return value;
+
+	constant result{ type, {} };
+
+	if (type == number_type::float_point)
+		result.value.fp_number = value.type == number_type::integer ? float(value.value.int_number) : float(value.value.uint_number);
+	else if (value.type != number_type::float_point)
+		result.value.uint_number = value.value.uint_number; // 整数之间：按位保留
+	else
+	{
+		const double real = value.value.fp_number;
+
+		if (real != real)
+			result.value.uint_number = 0;
+		else if (type == number_type::integer)
+			result.value.int_number = real <= -2147483648.0 ? std::numeric_limits<int32_t>::min() : real >= 2147483647.0 ? std::numeric_limits<int32_t>::max() : int32_t(real);
+		else
+			result.value.uint_number = real <= 0 ? 0 : real >= 4294967295.0 ? std::numeric_limits<uint32_t>::max() : uint32_t(real);
+	}
+
+	return result;
+}
+
+std::optional<constant> compiler::constant_folding::fold_binary(operand_type op, constant left, constant right)
+{
+	// 移位：结果取左操作数的类型，移位量只取低5位
+	number_type type;
+
+	if (is_shift(op))
+	{
+		if (right.type != number_type::integer && right.type != number_type::unsigned_integer) return std::nullopt;
+		type = left.type;
+	}
+	else
+	{
+		type = common_type(left.type, right.type);
+		if (type == number_type::none) return std::nullopt;
+
+		left = convert(left, type);
+		right = convert(right, type);
+	}
+
+	if (size_t(op) >= operand_count || size_t(type) >= type_count) return std::nullopt;
+
+	const fold_kernel kernel = kernel_table[size_t(op)][size_t(type)];
+	if (!kernel) return std::nullopt;
+
+	constant result{ is_comparison(op) ? number_type::integer : type, {} };
+	if (!kernel(left.value, right.value, result.value)) return std::nullopt;
+
+	return result;
+}
+
+std::optional<constant> compiler::constant_folding::fold_prefix(operand_type op, constant operand)
+{
+	if (op != operand_type::bit_not || size_t(operand.type) >= type_count) return std::nullopt;
+
+	const fold_kernel kernel = kernel_table[size_t(op)][size_t(operand.type)];
+	if (!kernel) return std::nullopt;
+
+	constant result{ operand.type, {} };
+	if (!kernel(operand.value, {}, result.value)) return std::nullopt;
+
+	return result;
+}
@@ -0,0 +1,182 @@
+// compiler-constant-folding.h: 带类型的常量折叠
+
+#pragma once
+
+#include "compiler-head.h"
+#include "compiler-base.h"
+
+namespace compiler::constant_folding
+{
+	// 带类型的常量
+	struct constant
+	{
+		number_type type = number_type::none;
+		number_union value;
+	};
+
+	// 折叠核：两个操作数已统一为同一类型（移位时右操作数只取低5位），结果写入 result；无法在编译期求值时（如除数为零）返回 false
+	// 整数运算按32位回绕，比较运算的结果为有符号整数 0 或 1
+	using fold_kernel = bool(*)(number_union left, number_union right, number_union& result);
+
+	constexpr bool is_comparison(operand_type op)
+	{
+		return op >= operand_type::equal && op <= operand_type::smaller_or_equal;
+	}
+
+	constexpr bool is_shift(operand_type op)
+	{
+		return op == operand_type::bit_lsh || op == operand_type::bit_rsh;
+	}
+
+	// 交换两个操作数后的等价运算符：可交换的运算为自身，大小比较互换方向，不可交换时为 none
+	constexpr operand_type swapped(operand_type op)
+	{
+		switch (op)
+		{
+		case operand_type::add:
+		case operand_type::mul:
+		case operand_type::bit_and:
+		case operand_type::bit_or:
+		case operand_type::bit_xor:
+		case operand_type::equal:
+		case operand_type::not_equal:
+			return op;
+
+		case operand_type::larger: return operand_type::smaller;
+		case operand_type::smaller: return operand_type::larger;
+		case operand_type::larger_or_equal: return operand_type::smaller_or_equal;
+		case operand_type::smaller_or_equal: return operand_type::larger_or_equal;
+
+		default:
+			return operand_type::none;
+		}
+	}
+
+	// 运算在该类型上是否可折叠：浮点数不参与取模、位运算与移位，取地址不可折叠
+	constexpr bool is_foldable(operand_type op, number_type type)
+	{
+		if (type == number_type::none) return false;
+
+		switch (op)
+		{
+		case operand_type::add:
+		case operand_type::sub:
+		case operand_type::mul:
+		case operand_type::div:
+			return true;
+
+		case operand_type::mod:
+		case operand_type::bit_not:
+		case operand_type::bit_and:
+		case operand_type::bit_or:
+		case operand_type::bit_xor:
+		case operand_type::bit_lsh:
+		case operand_type::bit_rsh:
+			return type != number_type::float_point;
+
+		default:
+			return is_comparison(op);
+		}
+	}
+
+	template<operand_type op, number_type type>
+	bool kernel(number_union left, number_union right, number_union& result)
+	{
+		if constexpr (type == number_type::float_point)
+		{
+			const float a = left.fp_number, b = right.fp_number;
+
+			if constexpr (op == operand_type::add) result.fp_number = a + b;
+			else if constexpr (op == operand_type::sub) result.fp_number = a - b;
+			else if constexpr (op == operand_type::mul) result.fp_number = a * b;
+			else if constexpr (op == operand_type::div)
+			{
+				if (b == 0) return false;
+				result.fp_number = a / b;
+			}
+			else if constexpr (op == operand_type::equal) result.int_number = a == b;
+			else if constexpr (op == operand_type::not_equal) result.int_number = a != b;
+			else if constexpr (op == operand_type::larger) result.int_number = a > b;
+			else if constexpr (op == operand_type::larger_or_equal) result.int_number = a >= b;
+			else if constexpr (op == operand_type::smaller) result.int_number = a < b;
+			else if constexpr (op == operand_type::smaller_or_equal) result.int_number = a <= b;
+		}
+		else
+		{
+			// 加减乘与位运算以无符号数计算，有符号数随之按补码回绕
+			constexpr bool is_signed = type == number_type::integer;
+			const uint32_t a = left.uint_number, b = right.uint_number;
+			const int32_t sa = left.int_number, sb = right.int_number;
+
+			if constexpr (op == operand_type::add) result.uint_number = a + b;
+			else if constexpr (op == operand_type::sub) result.uint_number = a - b;
+			else if constexpr (op == operand_type::mul) result.uint_number = a * b;
+			else if constexpr (op == operand_type::div || op == operand_type::mod)
+			{
+				if (b == 0) return false;
+
+				if constexpr (is_signed)
+				{
+					// INT32_MIN / -1 溢出：商回绕为 INT32_MIN，余数为 0
+					if (sa == std::numeric_limits<int32_t>::min() && sb == -1)
+						result.int_number = op == operand_type::div ? sa : 0;
+					else
+						result.int_number = op == operand_type::div ? sa / sb : sa % sb;
+				}
+				else
+					result.uint_number = op == operand_type::div ? a / b : a % b;
+			}
+			else if constexpr (op == operand_type::bit_not) result.uint_number = ~a;
+			else if constexpr (op == operand_type::bit_and) result.uint_number = a & b;
+			else if constexpr (op == operand_type::bit_or) result.uint_number = a | b;
+			else if constexpr (op == operand_type::bit_xor) result.uint_number = a ^ b;
+			else if constexpr (op == operand_type::bit_lsh) result.uint_number = a << (b & 31);
+			else if constexpr (op == operand_type::bit_rsh)
+			{
+				if constexpr (is_signed) result.int_number = sa >> (b & 31); // 算术右移
+				else result.uint_number = a >> (b & 31);
+			}
+			else if constexpr (op == operand_type::equal) result.int_number = a == b;
+			else if constexpr (op == operand_type::not_equal) result.int_number = a != b;
+			else if constexpr (op == operand_type::larger) result.int_number = is_signed ? sa > sb : a > b;
+			else if constexpr (op == operand_type::larger_or_equal) result.int_number = is_signed ? sa >= sb : a >= b;
+			else if constexpr (op == operand_type::smaller) result.int_number = is_signed ? sa < sb : a < b;
+			else if constexpr (op == operand_type::smaller_or_equal) result.int_number = is_signed ? sa <= sb : a <= b;
+		}
+
+		return true;
+	}
+
+	constexpr size_t operand_count = size_t(operand_type::explanation) + 1;
+	constexpr size_t type_count = size_t(number_type::float_point) + 1;
+
+	// 按 [operand_type][number_type] 索引的折叠核表，编译期生成，不可折叠的组合为空
+	constexpr std::array<std::array<fold_kernel, type_count>, operand_count> kernel_table = []<size_t... i>(std::index_sequence<i...>)
+	{
+		std::array<std::array<fold_kernel, type_count>, operand_count> table{};
+
+		auto entry = [&]<size_t index>(std::integral_constant<size_t, index>)
+		{
+			constexpr auto op = operand_type(index / type_count);
+			constexpr auto type = number_type(index % type_count);
+
+			if constexpr (is_foldable(op, type))
+				table[size_t(op)][size_t(type)] = &kernel<op, type>;
+		};
+
+		(entry(std::integral_constant<size_t, i>()), ...);
+		return table;
+	}(std::make_index_sequence<operand_count * type_count>());
+
+	// 二元运算的操作数统一到的类型：浮点数优先于无符号整数，无符号整数优先于有符号整数
+	number_type common_type(number_type left, number_type right);
+
+	// 类型转换：整数之间按位保留，浮点数转整数向零截断，超出范围时取最接近的可表示值，NaN 转为 0
+	constant convert(constant value, number_type type);
+
+	// 折叠二元运算，不可折叠时返回空
+	std::optional<constant> fold_binary(operand_type op, constant left, constant right);
+
+	// 折叠前缀运算，不可折叠时返回空
+	std::optional<constant> fold_prefix(operand_type op, constant operand);
+}
@@ -0,0 +1,227 @@
+// compiler-dead-code.cpp: 常量条件分支裁剪与死代码消除
+
+#include "compiler-dead-code.h"
+
+using namespace compiler;
+using namespace compiler::ir;
+
+namespace
+{
+	// 自 block 的前驱中删除 predecessor 的一次出现，同时删除各 φ 对应的操作数
+	void remove_predecessor(function& fn, block_id block, block_id predecessor)
+	{
+		auto& target = fn.blocks[block];
+
+		const auto position = std::find(target.predecessors.begin(), target.predecessors.end(), predecessor);
+		const auto index = size_t(position - target.predecessors.begin());
+		target.predecessors.erase(position);
+
+		for (const auto phi : target.phis)
+		{
+			auto operands = fn.operands_of(phi);
+			std::copy(operands.begin() + index + 1, operands.end(), operands.begin() + index);
+			fn.values[phi].c--;
+		}
+	}
+
+	// 删除边 from -> to 的一次出现
+	void remove_edge(function& fn, block_id from, block_id to)
+	{
+		auto& successors = fn.blocks[from].successors;
+		successors.erase(std::find(successors.begin(), successors.end(), to));
+
+		remove_predecessor(fn, to, from);
+	}
+}
+
+bool compiler::ir::prune_branches(function& fn, analysis_manager&)
+{
+	bool changed = false;
+
+	// 条件为常量或两侧目标相同的分支改为跳转
+	for (block_id b = 0; b < fn.blocks.size(); b++)
+	{
+		const auto terminator = fn.blocks[b].terminator(fn.values);
+		if (terminator == no_value || fn.values[terminator].code != opcode::branch) continue;
+
+		auto& inst = fn.values[terminator];
+		const auto& condition = fn.values[inst.a];
+
+		if (condition.code != opcode::constant && inst.b != inst.c) continue;
+
+		const block_id taken = condition.code == opcode::constant && condition.a == 0 ? inst.c : inst.b;
+		const block_id other = taken == inst.b ? inst.c : inst.b;
+
+		inst.code = opcode::jump;
+		inst.a = taken;
+		inst.b = inst.c = 0;
+
+		remove_edge(fn, b, other);
+		changed = true;
+	}
+
+	// 自入口不可达的块：断开其通往可达块的边
+	std::vector<bool> removed(fn.blocks.size(), true);
+	std::vector<block_id> stack{ 0 };
+	removed[0] = false;
+
+	while (!stack.empty())
+	{
+		const auto block = stack.back();
+		stack.pop_back();
+
+		for (const auto successor : fn.blocks[block].successors)
+			if (removed[successor])
+			{
+				removed[successor] = false;
+				stack.push_back(successor);
+			}
+	}
+
+	bool compact = false;
+
+	for (block_id b = 0; b < fn.blocks.size(); b++)
+	{
+		if (!removed[b]) continue;
+
+		for (const auto successor : fn.blocks[b].successors)
+			if (!removed[successor])
+				remove_predecessor(fn, successor, b);
+
+		compact = true;
+	}
+
+	// 前驱减少后 φ 可能变得平凡，消去后只有唯一前驱的块不再含 φ
+	if (changed || compact)
+		remove_trivial_phis(fn);
+
+	// 只跳转到唯一前驱为自身的块时，将其并入本块，继续检查并入后的结尾
+	for (block_id b = 0; b < fn.blocks.size(); b++)
+	{
+		if (removed[b]) continue;
+
+		while (true)
+		{
+			auto& block = fn.blocks[b];
+
+			const auto terminator = block.terminator(fn.values);
+			if (terminator == no_value || fn.values[terminator].code != opcode::jump) break;
+
+			const block_id next = fn.values[terminator].a;
+			auto& target = fn.blocks[next];
+
+			if (next == b || next == 0 || target.predecessors.size() != 1 || !target.phis.empty()) break;
+
+			fn.values[terminator].code = opcode::nop;
+			block.code.pop_back();
+
+			for (const auto id : target.code)
+			{
+				fn.values[id].block = b;
+				block.code.push_back(id);
+			}
+
+			block.successors = std::move(target.successors);
+
+			for (const auto successor : block.successors)
+				for (auto& predecessor : fn.blocks[successor].predecessors)
+					if (predecessor == next) predecessor = b;
+
+			target.code.clear();
+			target.successors.clear();
+			target.predecessors.clear();
+
+			removed[next] = true;
+			compact = true;
+		}
+	}
+
+	if (compact)
+		compact_blocks(fn, removed);
+
+	return changed || compact;
+}
+
+bool compiler::ir::eliminate_dead_code(function& fn, analysis_manager&)
+{
+	std::vector<bool> live(fn.values.size());
+	std::vector<value_id> worklist;
+
+	auto mark = [&](value_id id)
+	{
+		if (live[id]) return;
+
+		live[id] = true;
+		worklist.push_back(id);
+	};
+
+	for (const auto& block : fn.blocks)
+		for (const auto id : block.code)
+			if (fn.values[id].has_side_effect())
+				mark(id);
+
+	while (!worklist.empty())
+	{
+		const auto id = worklist.back();
+		worklist.pop_back();
+
+		fn.for_each_operand(id, mark);
+	}
+
+	bool changed = false;
+
+	auto dead = [&](value_id id)
+	{
+		if (live[id]) return false;
+
+		fn.values[id].code = opcode::nop;
+		changed = true;
+		return true;
+	};
+
+	for (auto& block : fn.blocks)
+	{
+		std::erase_if(block.phis, dead);
+		std::erase_if(block.code, dead);
+	}
+
+	return changed;
+}
+
+bool compiler::ir::remove_unread_globals(module& program)
+{
+	std::unordered_set<variable_index> read;
+
+	for (const auto& fn : program.functions)
+		for (const auto& block : fn.blocks)
+			for (const auto id : block.code)
+			{
+				const auto& inst = fn.values[id];
+
+				// 全局变量可能位于 @ 可访问的内存中：程序读取内存或有调用时，任何全局变量都可能被读取
+				if (inst.code == opcode::load || inst.code == opcode::call)
+					return false;
+
+				if (inst.code == opcode::load_global)
+					read.insert(inst.a);
+			}
+
+	bool changed = false;
+
+	for (auto& fn : program.functions)
+		for (auto& block : fn.blocks)
+			std::erase_if(block.code, [&](value_id id)
+			{
+				auto& inst = fn.values[id];
+				if (inst.code != opcode::store_global || read.contains(inst.a)) return false;
+
+				inst.code = opcode::nop;
+				changed = true;
+				return true;
+			});
+
+	const auto count = program.globals.size();
+	std::erase_if(program.globals, [&](const global_variable& global) { return !read.contains(global.variable); });
+
+	return changed || program.globals.size() != count;
+}
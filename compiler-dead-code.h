@@ -0,0 +1,24 @@
+// compiler-dead-code.h: 常量条件分支裁剪与死代码消除
+
+#pragma once
+
+#include "compiler-head.h"
+#include "compiler-ir.h"
+#include "compiler-pass-manager.h"
+
+namespace compiler::ir
+{
+	// 裁剪分支：条件为常量或两侧目标相同的分支改为跳转，删除入口不可达的块，
+	// 并将只有唯一前驱且该前驱只跳转到它的块并入前驱；块编号随之压缩
+	bool prune_branches(function& fn, analysis_manager& analyses);
+
+	// 死代码消除：自有副作用的指令（@ 写入、全局变量写入、调用与跳转返回）沿操作数标记，删除其余的指令
+	// 未使用的声明与不被读取的局部变量赋值在 SSA 中即为无人使用的值，随之删除；不改变控制流
+	bool eliminate_dead_code(function& fn, analysis_manager& analyses);
+
+	// 删除整个程序中从不被读取的全局变量及对其的写入；程序中有 @ 读取或调用时全局变量都可能被读取，不删除
+	bool remove_unread_globals(module& program);
+
+	constexpr pass prune_branches_pass{ "prune-branches", &prune_branches, preserve_none };
+	constexpr pass dead_code_pass{ "dce", &eliminate_dead_code, preserves(analysis_dominators) };
+}
@@ -0,0 +1,262 @@
+// compiler-gvn.cpp: 基于支配树的全局值编号
+
+#include "compiler-gvn.h"
+#include "compiler-constant-folding.h"
+
+using namespace compiler;
+using namespace compiler::ir;
+
+namespace
+{
+	// 值表：开放寻址，槽位记录值编号与读取时的写入代次，以该值的指令内容为键
+	// 槽位不随离开支配子树删除：查到的值只在其所在块支配当前块时可用，否则由当前的指令取代
+	// 先序遍历中离开的子树不会再被访问，被取代的值此后不再可见
+	struct value_table
+	{
+		struct slot
+		{
+			value_id value = no_value;
+			uint32_t epoch = 0;
+		};
+
+		std::vector<slot> slots; // 容量为2的幂
+		size_t count = 0;
+
+		static size_t hash(const instruction& inst, uint32_t epoch)
+		{
+			uint64_t h = (uint64_t(inst.code) << 16 | uint64_t(inst.op) << 8 | uint64_t(inst.type)) ^ (uint64_t(epoch) << 24);
+			h = (h ^ (uint64_t(inst.a) << 32 | inst.b)) * 0x9E3779B97F4A7C15ull;
+			return size_t(h ^ (h >> 29));
+		}
+
+		static bool same(const instruction& a, const instruction& b)
+		{
+			return a.code == b.code && a.op == b.op && a.type == b.type && a.a == b.a && a.b == b.b;
+		}
+
+		// 返回与 id 相同且支配 block 的已有值，没有时记录 id 并返回 no_value
+		value_id find_or_insert(const function& fn, const dominator_tree& dominators, value_id id, uint32_t epoch)
+		{
+			// 负载超过一半时扩容
+			if ((count + 1) * 2 > slots.size())
+			{
+				std::vector<slot> old(std::max<size_t>(64, slots.size() * 2));
+				old.swap(slots);
+
+				const size_t mask = slots.size() - 1;
+				for (const auto& entry : old)
+					if (entry.value != no_value)
+					{
+						size_t i = hash(fn.values[entry.value], entry.epoch) & mask;
+						while (slots[i].value != no_value) i = (i + 1) & mask;
+						slots[i] = entry;
+					}
+			}
+
+			const auto& inst = fn.values[id];
+			const size_t mask = slots.size() - 1;
+
+			for (size_t i = hash(inst, epoch) & mask;; i = (i + 1) & mask)
+			{
+				auto& entry = slots[i];
+
+				if (entry.value == no_value)
+				{
+					entry = { id, epoch };
+					count++;
+					return no_value;
+				}
+
+				if (entry.epoch != epoch || !same(fn.values[entry.value], inst)) continue;
+
+				if (dominators.dominates(fn.values[entry.value].block, inst.block))
+					return entry.value;
+
+				entry.value = id;
+				return no_value;
+			}
+		}
+	};
+
+	struct numbering
+	{
+		function& fn;
+		const dominator_tree& dominators;
+
+		value_table table;
+		std::vector<value_id> forward; // 被合并的值 -> 代替它的值
+
+		// 各块出口处内存与全局变量的写入代次
+		std::vector<uint32_t> memory_out, global_out;
+		uint32_t next_epoch = 1;
+
+		bool changed = false;
+
+		numbering(function& fn, const dominator_tree& dominators) : fn(fn), dominators(dominators), forward(fn.values.size()), memory_out(fn.blocks.size()), global_out(fn.blocks.size())
+		{
+			for (value_id i = 0; i < forward.size(); i++) forward[i] = i;
+		}
+
+		value_id find(value_id value)
+		{
+			while (forward[value] != value)
+			{
+				forward[value] = forward[forward[value]];
+				value = forward[value];
+			}
+
+			return value;
+		}
+
+		// 以 replacement 代替 id，返回 true 表示 id 应自块中删除
+		bool replace(value_id id, value_id replacement)
+		{
+			forward[id] = replacement;
+			fn.values[id].code = opcode::nop;
+			changed = true;
+			return true;
+		}
+
+		std::pair<bool, value_id> rank(value_id value) const
+		{
+			return { fn.values[value].code == opcode::constant, value };
+		}
+
+		// 同一块中操作数相同的 φ
+		value_id same_phi(const std::vector<value_id>& phis, size_t index)
+		{
+			const auto operands = fn.operands_of(phis[index]);
+
+			for (size_t i = 0; i < index; i++)
+			{
+				const auto other = phis[i];
+				if (fn.values[other].code != opcode::phi || fn.values[other].type != fn.values[phis[index]].type) continue;
+
+				const auto candidate = fn.operands_of(other);
+				if (std::equal(operands.begin(), operands.end(), candidate.begin(), candidate.end()))
+					return other;
+			}
+
+			return no_value;
+		}
+
+		void visit(block_id b)
+		{
+			auto& block = fn.blocks[b];
+
+			// 唯一的前驱即为直接支配者，沿用其出口的代次；有多个前驱时其他路径上可能有写入
+			uint32_t memory = 0, global = 0;
+
+			if (block.predecessors.size() == 1)
+			{
+				memory = memory_out[block.predecessors[0]];
+				global = global_out[block.predecessors[0]];
+			}
+			else
+			{
+				memory = next_epoch++;
+				global = next_epoch++;
+			}
+
+			for (const auto phi : block.phis)
+				fn.for_each_operand(phi, [&](value_id& use) { use = find(use); });
+
+			for (size_t i = 0; i < block.phis.size(); i++)
+				if (const auto other = same_phi(block.phis, i); other != no_value)
+					replace(block.phis[i], other);
+
+			std::erase_if(block.phis, [&](value_id phi) { return fn.values[phi].code == opcode::nop; });
+
+			std::erase_if(block.code, [&](value_id id)
+			{
+				fn.for_each_operand(id, [&](value_id& use) { use = find(use); });
+
+				auto& inst = fn.values[id];
+				uint32_t epoch = 0;
+
+				switch (inst.code)
+				{
+				case opcode::binary:
+					// 可交换的运算与大小比较按操作数编号排列、常量在右，使 x + y 与 y + x 相同
+					if (constant_folding::swapped(inst.op) != operand_type::none && rank(inst.b) < rank(inst.a))
+					{
+						std::swap(inst.a, inst.b);
+						inst.op = constant_folding::swapped(inst.op);
+					}
+					break;
+
+				case opcode::constant:
+				case opcode::parameter:
+				case opcode::unary:
+				case opcode::convert:
+					break;
+
+				case opcode::load:
+					epoch = memory;
+					break;
+
+				case opcode::load_global:
+					epoch = global;
+					break;
+
+				case opcode::store:
+					// @ 写入的地址可能落在全局变量上，两者的代次都要更新
+					memory = next_epoch++;
+					global = next_epoch++;
+					return false;
+
+				case opcode::store_global:
+					// 全局变量可能位于 @ 可访问的内存中，同样更新内存的代次
+					memory = next_epoch++;
+					global = next_epoch++;
+					return false;
+
+				case opcode::call:
+					memory = next_epoch++;
+					global = next_epoch++;
+					return false;
+
+				default:
+					return false;
+				}
+
+				const auto existing = table.find_or_insert(fn, dominators, id, epoch);
+				return existing != no_value && replace(id, existing);
+			});
+
+			memory_out[b] = memory;
+			global_out[b] = global;
+		}
+	};
+}
+
+bool compiler::ir::number_values(function& fn, analysis_manager& analyses)
+{
+	const auto& dominators = analyses.dominators();
+	numbering state(fn, dominators);
+
+	// 支配树先序遍历
+	std::vector<block_id> stack{ 0 };
+
+	while (!stack.empty())
+	{
+		const auto block = stack.back();
+		stack.pop_back();
+
+		state.visit(block);
+
+		const auto children = dominators.children_of(block);
+		for (size_t i = children.size(); i-- > 0;)
+			stack.push_back(children[i]);
+	}
+
+	if (!state.changed) return false;
+
+	// 回边流入 φ 的值在 φ 所在块之后才被合并
+	for (value_id i = 0; i < fn.values.size(); i++)
+		if (fn.values[i].code != opcode::nop)
+			fn.for_each_operand(i, [&](value_id& use) { use = state.find(use); });
+
+	remove_trivial_phis(fn);
+	return true;
+}
@@ -0,0 +1,18 @@
+// compiler-gvn.h: 基于支配树的全局值编号
+
+#pragma once
+
+#include "compiler-head.h"
+#include "compiler-ir.h"
+#include "compiler-pass-manager.h"
+
+namespace compiler::ir
+{
+	// 全局值编号：按支配树先序遍历，与支配本块的块中已有的相同指令合并，跨越语句与 if、while 的语句块
+	// 可交换的运算与大小比较按操作数编号排列、常量在右；同一块中操作数相同的 φ 合并，合并后变得平凡的 φ 随之消去
+	// 读取内存只在其间没有 @ 写入、全局变量写入与调用时合并，读取全局变量只在其间没有全局变量写入、@ 写入与调用时合并；有多个前驱的块视为其间可能有写入
+	// 变量在 SSA 中即为值，复制与遮蔽的同名变量不影响编号；不改变控制流
+	bool number_values(function& fn, analysis_manager& analyses);
+
+	constexpr pass value_numbering_pass{ "gvn", &number_values, preserves(analysis_dominators) };
+}
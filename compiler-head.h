@@ -6,9 +6,23 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <array>
+#include <deque>
 #include <unordered_map>
+#include <unordered_set>
 #include <optional>
-#include <regex>
 #include <functional>
 #include <unordered_map>
-#include <format>
\ No newline at end of file
+#include <format>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <cstdint>
+#include <thread>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <chrono>
\ No newline at end of file
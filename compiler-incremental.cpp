@@ -0,0 +1,307 @@
+// compiler-incremental.cpp: 增量词法分析与语法分析
+
+#include "compiler-incremental.h"
+
+using namespace compiler;
+
+compiler::incremental_document::incremental_document(std::string text) : source(std::move(text))
+{
+	rebuild();
+}
+
+void compiler::incremental_document::stabilize_symbols(size_t first)
+{
+	for (size_t id = first; id < symbols.names.size(); id++)
+	{
+		// 查找表的键不可原地修改，先移除再以稳定存储中的名称重新加入
+		const std::string_view name = names.emplace_back(symbols.names[id]);
+		symbols.lut.erase(symbols.names[id]);
+		symbols.lut.emplace(name, symbol_id(id));
+		symbols.names[id] = name;
+	}
+}
+
+void compiler::incremental_document::stabilize(token& t)
+{
+	switch (t.type)
+	{
+	case token_type::identifier:
+		t.literal = symbols.name(t.symbol);
+		break;
+
+	case token_type::keyword:
+	case token_type::number_type:
+		t.literal = *words.emplace(t.literal).first;
+		break;
+
+	default:
+		t.literal = {}; // 其余词元的字面量不被使用
+		break;
+	}
+}
+
+document_item compiler::incremental_document::parse_item(size_t& index)
+{
+	auto& tree = context->tree;
+	const size_t diagnostics_mark = context->diagnostics.size();
+	const size_t functions_mark = tree.functions.size();
+
+	document_item item;
+	item.token_begin = uint32_t(index);
+
+	statement_parser::parse_top_level(list, index, *context);
+
+	item.token_end = uint32_t(index);
+	item.statements.assign(context->pending.begin(), context->pending.end());
+	context->pending.clear();
+
+	if (tree.functions.size() > functions_mark)
+		item.function = uint32_t(tree.functions.size() - 1);
+
+	item.diagnostics.assign(context->diagnostics.begin() + diagnostics_mark, context->diagnostics.end());
+	context->diagnostics.erase(context->diagnostics.begin() + diagnostics_mark, context->diagnostics.end());
+
+	last_edit.reparsed_items++;
+	return item;
+}
+
+void compiler::incremental_document::rebuild()
+{
+	last_edit = {};
+	last_edit.full_rebuild = true;
+
+	lex_error.reset();
+	list.clear();
+	units.clear();
+
+	line_starts.assign(1, 0);
+	for (size_t pos = source.find('\n'); pos != std::string::npos; pos = source.find('\n', pos + 1))
+		line_starts.push_back(pos + 1);
+
+	const size_t first_symbol = symbols.size();
+
+	try
+	{
+		list = tokenizer::tokenize(source, symbols);
+	}
+	catch (const tokenizer_exception& e)
+	{
+		stabilize_symbols(first_symbol);
+		list.clear();
+		lex_error = e;
+		context = std::make_unique<parse_context>();
+		return;
+	}
+
+	stabilize_symbols(first_symbol);
+	for (auto& t : list) stabilize(t);
+
+	last_edit.relexed_tokens = list.size();
+	reparse();
+}
+
+void compiler::incremental_document::reparse()
+{
+	context = std::make_unique<parse_context>();
+	context->lazy_functions = false; // 单元须自包含，函数体随定义一并解析
+
+	units.clear();
+
+	size_t index = 0;
+	while (index < list.size())
+		units.push_back(parse_item(index));
+
+	rebuild_nodes = context->tree.nodes.size();
+}
+
+void compiler::incremental_document::apply(const text_edit& edit)
+{
+	if (edit.offset > source.size() || edit.removed > source.size() - edit.offset)
+		throw compiler_exception("Text edit out of range.");
+
+	const std::string inserted(edit.inserted); // 插入内容可能引用本文档的源码
+
+	if (lex_error)
+	{
+		source.replace(edit.offset, edit.removed, inserted);
+		rebuild();
+		return;
+	}
+
+	last_edit = {};
+
+	const size_t edit_begin = edit.offset;
+	const size_t old_end = edit.offset + edit.removed;
+	const size_t new_end = edit.offset + inserted.size();
+	const ptrdiff_t delta = ptrdiff_t(new_end) - ptrdiff_t(old_end);
+
+	// 更新行首偏移表：编辑区间内的行首删去，插入内容中的换行新增行首，其后的行首整体平移
+	std::vector<size_t> old_starts = std::move(line_starts);
+	{
+		const auto removed_begin = std::upper_bound(old_starts.begin(), old_starts.end(), edit_begin);
+		const auto removed_end = std::upper_bound(old_starts.begin(), old_starts.end(), old_end);
+
+		line_starts.reserve(old_starts.size() + 1);
+		line_starts.assign(old_starts.begin(), removed_begin);
+
+		for (size_t pos = inserted.find('\n'); pos != std::string::npos; pos = inserted.find('\n', pos + 1))
+			line_starts.push_back(edit_begin + pos + 1);
+
+		for (auto it = removed_end; it != old_starts.end(); it++)
+			line_starts.push_back(size_t(ptrdiff_t(*it) + delta));
+	}
+
+	source.replace(edit_begin, edit.removed, inserted);
+
+	auto old_offset = [&](size_t i) { return old_starts[list[i].line] + list[i].character; };
+
+	// 自编辑处之前的最后一个词元起重新扫描：该词元可能与插入内容连成一个词元
+	const size_t first_after = std::partition_point(list.begin(), list.end(), [&](const token& t) { return old_starts[t.line] + t.character < edit_begin; }) - list.begin();
+	const size_t relex_begin = first_after > 0 ? first_after - 1 : 0;
+
+	size_t offset = 0, line = 0;
+	if (first_after > 0)
+	{
+		line = list[relex_begin].line;
+		offset = old_starts[line] + list[relex_begin].character; // 位于编辑处之前，新旧偏移相同
+	}
+
+	// 越过编辑区间之后，新词元与某个旧词元的偏移（平移后）相同即重新对齐，其后的旧词元原样保留
+	size_t sync = first_after;
+	while (sync < list.size() && old_offset(sync) < old_end) sync++;
+
+	token_list fresh;
+	bool aligned = false;
+	const size_t first_symbol = symbols.size();
+
+	try
+	{
+		tokenizer::tokenize_from(source, offset, line, line_starts[line], symbols, [&](token& t, size_t pos)
+		{
+			if (pos >= new_end)
+			{
+				const size_t old_pos = size_t(ptrdiff_t(pos) - delta);
+
+				while (sync < list.size() && old_offset(sync) < old_pos) sync++;
+
+				if (sync < list.size() && old_offset(sync) == old_pos)
+				{
+					aligned = true;
+					return false;
+				}
+			}
+
+			fresh.push_back(t);
+			return true;
+		});
+	}
+	catch (const tokenizer_exception& e)
+	{
+		stabilize_symbols(first_symbol);
+		list.clear();
+		units.clear();
+		lex_error = e;
+		context = std::make_unique<parse_context>();
+		return;
+	}
+
+	if (!aligned) sync = list.size();
+
+	stabilize_symbols(first_symbol);
+	for (auto& t : fresh) stabilize(t);
+
+	last_edit.relexed_tokens = fresh.size();
+
+	// 保留的旧词元平移位置：与编辑区间末尾同行的还须平移列号
+	const size_t old_end_line = std::upper_bound(old_starts.begin(), old_starts.end(), old_end) - old_starts.begin() - 1;
+	const size_t new_end_line = std::upper_bound(line_starts.begin(), line_starts.end(), new_end) - line_starts.begin() - 1;
+	const size_t old_end_column = old_end - old_starts[old_end_line];
+	const size_t new_end_column = new_end - line_starts[new_end_line];
+
+	auto shift_position = [&](size_t& line, size_t& character)
+	{
+		if (line == old_end_line)
+			character = character - old_end_column + new_end_column;
+
+		line = line - old_end_line + new_end_line;
+	};
+
+	for (size_t i = sync; i < list.size(); i++)
+	{
+		if (old_end_line == new_end_line && list[i].line != old_end_line) break; // 行号不变时只有同行的词元需要平移
+		shift_position(list[i].line, list[i].character);
+	}
+
+	// 替换词元：旧区间 [relex_begin, sync) 换为 fresh，其后词元编号平移 token_delta
+	const ptrdiff_t token_delta = ptrdiff_t(fresh.size()) - ptrdiff_t(sync - relex_begin);
+
+	// 先调整区间长度再覆盖，其后的词元只整体移动一次
+	if (token_delta > 0)
+		list.insert(list.begin() + sync, size_t(token_delta), token());
+	else if (token_delta < 0)
+		list.erase(list.begin() + sync + token_delta, list.begin() + sync);
+
+	std::copy(fresh.begin(), fresh.end(), list.begin() + relex_begin);
+
+	// 重新解析：首个受影响的单元为末尾词元不早于 relex_begin 的单元（解析单元时可能前瞻一个词元）
+	const size_t first_unit = std::partition_point(units.begin(), units.end(), [&](const document_item& item) { return item.token_end < relex_begin; }) - units.begin();
+
+	// 可复用的旧单元须完全位于替换区间之后
+	size_t reuse = std::partition_point(units.begin(), units.end(), [&](const document_item& item) { return item.token_begin < sync; }) - units.begin();
+
+	std::vector<document_item> reparsed;
+	size_t index = first_unit < units.size() ? units[first_unit].token_begin : 0;
+
+	while (true)
+	{
+		if (index >= list.size())
+		{
+			reuse = units.size();
+			break;
+		}
+
+		// 新单元的起点与某个旧单元的起点（平移后）相同即重新对齐
+		while (reuse < units.size() && ptrdiff_t(units[reuse].token_begin) + token_delta < ptrdiff_t(index)) reuse++;
+
+		if (reuse < units.size() && ptrdiff_t(units[reuse].token_begin) + token_delta == ptrdiff_t(index))
+			break;
+
+		reparsed.push_back(parse_item(index));
+	}
+
+	// 复用的单元平移词元区间、函数体位置与诊断位置
+	for (size_t i = reuse; i < units.size(); i++)
+	{
+		auto& item = units[i];
+		item.token_begin = uint32_t(item.token_begin + token_delta);
+		item.token_end = uint32_t(item.token_end + token_delta);
+
+		if (item.function != document_item::no_function)
+			context->tree.functions[item.function].body_token += token_delta;
+
+		for (auto& diagnostic : item.diagnostics)
+			if (diagnostic.pos_available && diagnostic.line >= old_end_line)
+				shift_position(diagnostic.line, diagnostic.character);
+	}
+
+	units.erase(units.begin() + first_unit, units.begin() + reuse);
+	units.insert(units.begin() + first_unit, std::make_move_iterator(reparsed.begin()), std::make_move_iterator(reparsed.end()));
+
+	// 被替换单元的节点不回收，累积过多时整体重新解析
+	if (context->tree.nodes.size() > 2 * rebuild_nodes + 4096)
+	{
+		reparse();
+		last_edit.full_rebuild = true;
+	}
+}
+
+std::vector<compiler_exception> compiler::incremental_document::diagnostics() const
+{
+	if (lex_error) return { *lex_error };
+
+	std::vector<compiler_exception> result;
+	for (const auto& item : units)
+		result.insert(result.end(), item.diagnostics.begin(), item.diagnostics.end());
+
+	return result;
+}
@@ -0,0 +1,99 @@
+// compiler-incremental.h: 增量词法分析与语法分析，供编辑器与监视模式使用
+
+#pragma once
+
+#include "compiler-head.h"
+#include "compiler-base.h"
+#include "compiler-tokenizer.h"
+#include "compiler-syntax-parser.h"
+
+namespace compiler
+{
+	// 文本编辑：将 [offset, offset + removed) 替换为 inserted，偏移按字节计
+	struct text_edit
+	{
+		size_t offset = 0;
+		size_t removed = 0;
+		std::string_view inserted;
+	};
+
+	// 顶层语法单元：一条全局声明或一个函数定义，占用词元列表中的连续区间 [token_begin, token_end)
+	struct document_item
+	{
+		static constexpr uint32_t no_function = UINT32_MAX;
+
+		uint32_t token_begin = 0;
+		uint32_t token_end = 0;
+
+		std::vector<statement_wrapper> statements; // 全局声明产生的语句
+		uint32_t function = no_function; // 函数定义在 syntax_tree::functions 中的编号
+
+		std::vector<syntax_parsing_exception> diagnostics; // 本单元的语法错误
+	};
+
+	// 最近一次更新的工作量
+	struct edit_statistics
+	{
+		size_t relexed_tokens = 0; // 重新扫描得到的词元数
+		size_t reparsed_items = 0; // 重新解析的顶层单元数
+		bool full_rebuild = false; // 是否整体重建
+	};
+
+	// 增量文档：持有源码、词元列表与语法树
+	// 编辑后只重新扫描编辑处附近的词元，直到新词元与旧词元重新对齐；只重新解析词元有变化的顶层单元，其余单元的语法树原样复用
+	// 词元字面量与标识符名称均指向文档自有的稳定存储，不引用随编辑移动的源码
+	// 被替换的单元留下的节点不回收，节点数超过上次整体解析时的两倍后整体重新解析
+	class incremental_document
+	{
+	private:
+		std::string source;
+		std::vector<size_t> line_starts{ 0 }; // 行首偏移表
+
+		symbol_interner symbols;
+		std::deque<std::string> names; // 标识符名称的稳定存储
+		std::unordered_set<std::string> words; // 关键词与数据类型字面量的稳定存储
+
+		token_list list;
+		std::vector<document_item> units;
+		std::unique_ptr<parse_context> context;
+
+		std::optional<tokenizer_exception> lex_error; // 词法错误；存在时词元与语法树为空，下次编辑整体重建
+
+		size_t rebuild_nodes = 0; // 上次整体解析后的节点数
+		edit_statistics last_edit;
+
+		// 新驻留的名称（编号不小于 first）移入稳定存储
+		void stabilize_symbols(size_t first);
+
+		// 词元字面量改为指向稳定存储
+		void stabilize(token& t);
+
+		// 解析 index 处的一个顶层单元
+		document_item parse_item(size_t& index);
+
+		// 整体重新扫描并解析
+		void rebuild();
+
+		// 整体重新解析
+		void reparse();
+
+	public:
+		incremental_document(std::string text);
+
+		incremental_document(const incremental_document&) = delete;
+		incremental_document& operator=(const incremental_document&) = delete;
+
+		// 应用一次编辑，偏移越界时抛出 compiler_exception
+		void apply(const text_edit& edit);
+
+		// 全部诊断：词法错误，或按单元顺序排列的语法错误
+		std::vector<compiler_exception> diagnostics() const;
+
+		inline const std::string& text() const { return source; }
+		inline const token_list& tokens() const { return list; }
+		inline const std::vector<document_item>& items() const { return units; }
+		inline const syntax_tree& tree() const { return context->tree; }
+		inline const symbol_interner& symbol_table() const { return symbols; }
+		inline const edit_statistics& statistics() const { return last_edit; }
+	};
+}
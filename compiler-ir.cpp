@@ -0,0 +1,1059 @@
+// compiler-ir.cpp: SSA 中间表示、自语法树的降低与支配树
+
+#include "compiler-ir.h"
+#include "compiler-constant-folding.h"
+
+using namespace compiler;
+using namespace compiler::ir;
+
+void compiler::ir::function::set_operands(value_id id, std::span<const value_id> uses)
+{
+	// uses 可能指向 operands 自身，此时按下标逐个复制，避免扩容使其失效；不按确切大小预留，以免每次追加都整体搬移
+	const size_t count = uses.size();
+	const bool aliased = count != 0 && uses.data() >= operands.data() && uses.data() < operands.data() + operands.size();
+	const size_t offset = aliased ? size_t(uses.data() - operands.data()) : 0;
+	const auto begin = uint32_t(operands.size());
+
+	if (aliased)
+		for (size_t i = 0; i < count; i++)
+			operands.push_back(operands[offset + i]);
+	else
+		operands.insert(operands.end(), uses.begin(), uses.end());
+
+	values[id].b = begin;
+	values[id].c = uint32_t(count);
+}
+
+dominator_tree compiler::ir::build_dominators(const function& fn)
+{
+	const auto count = uint32_t(fn.blocks.size());
+
+	dominator_tree tree;
+	tree.idom.assign(count, no_block);
+	tree.child_begin.assign(size_t(count) + 1, 0);
+	tree.enter.assign(count, 0);
+	tree.leave.assign(count, 0);
+
+	if (count == 0) return tree;
+
+	// 以显式栈深度优先求后序，再反转为逆后序
+	std::vector<std::pair<block_id, uint32_t>> stack;
+	std::vector<bool> visited(count);
+
+	stack.push_back({ 0, 0 });
+	visited[0] = true;
+
+	while (!stack.empty())
+	{
+		const auto [block, next] = stack.back();
+		const auto& successors = fn.blocks[block].successors;
+
+		if (next == successors.size())
+		{
+			tree.order.push_back(block);
+			stack.pop_back();
+			continue;
+		}
+
+		stack.back().second++;
+
+		if (const auto successor = successors[next]; !visited[successor])
+		{
+			visited[successor] = true;
+			stack.push_back({ successor, 0 });
+		}
+	}
+
+	std::reverse(tree.order.begin(), tree.order.end());
+
+	std::vector<uint32_t> rpo_number(count, UINT32_MAX);
+	for (uint32_t i = 0; i < tree.order.size(); i++)
+		rpo_number[tree.order[i]] = i;
+
+	// 沿直接支配者上溯到两块的最近公共支配者
+	auto intersect = [&](block_id a, block_id b)
+	{
+		while (a != b)
+		{
+			while (rpo_number[a] > rpo_number[b]) a = tree.idom[a];
+			while (rpo_number[b] > rpo_number[a]) b = tree.idom[b];
+		}
+
+		return a;
+	};
+
+	tree.idom[0] = 0;
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+
+		for (size_t i = 1; i < tree.order.size(); i++)
+		{
+			const auto block = tree.order[i];
+			block_id idom = no_block;
+
+			// 跳过尚未处理的前驱与不可达的前驱
+			for (const auto predecessor : fn.blocks[block].predecessors)
+				if (tree.idom[predecessor] != no_block)
+					idom = idom == no_block ? predecessor : intersect(predecessor, idom);
+
+			if (idom != tree.idom[block])
+			{
+				tree.idom[block] = idom;
+				changed = true;
+			}
+		}
+	}
+
+	// 子节点按逆后序排列，压缩存放
+	for (size_t i = 1; i < tree.order.size(); i++)
+		tree.child_begin[tree.idom[tree.order[i]] + 1]++;
+
+	for (uint32_t i = 0; i < count; i++)
+		tree.child_begin[i + 1] += tree.child_begin[i];
+
+	tree.children.resize(tree.order.size() - 1);
+
+	std::vector<uint32_t> fill(tree.child_begin.begin(), tree.child_begin.end() - 1);
+	for (size_t i = 1; i < tree.order.size(); i++)
+	{
+		const auto block = tree.order[i];
+		tree.children[fill[tree.idom[block]]++] = block;
+	}
+
+	// 先序遍历编号
+	uint32_t number = 0;
+
+	stack.push_back({ 0, 0 });
+	tree.enter[0] = number++;
+
+	while (!stack.empty())
+	{
+		const auto [block, next] = stack.back();
+		const auto children = tree.children_of(block);
+
+		if (next == children.size())
+		{
+			tree.leave[block] = number++;
+			stack.pop_back();
+			continue;
+		}
+
+		stack.back().second++;
+		tree.enter[children[next]] = number++;
+		stack.push_back({ children[next], 0 });
+	}
+
+	return tree;
+}
+
+use_list compiler::ir::build_uses(const function& fn)
+{
+	use_list uses;
+	uses.user_begin.assign(fn.values.size() + 1, 0);
+
+	auto for_each_instruction = [&](auto&& visit)
+	{
+		for (const auto& block : fn.blocks)
+		{
+			for (const auto id : block.phis) visit(id);
+			for (const auto id : block.code) visit(id);
+		}
+	};
+
+	// 先计数，再按前缀和填入
+	for_each_instruction([&](value_id id)
+	{
+		fn.for_each_operand(id, [&](value_id use) { uses.user_begin[use + 1]++; });
+	});
+
+	for (size_t i = 0; i < fn.values.size(); i++)
+		uses.user_begin[i + 1] += uses.user_begin[i];
+
+	uses.users.resize(uses.user_begin.back());
+
+	std::vector<uint32_t> fill(uses.user_begin.begin(), uses.user_begin.end() - 1);
+	for_each_instruction([&](value_id id)
+	{
+		fn.for_each_operand(id, [&](value_id use) { uses.users[fill[use]++] = id; });
+	});
+
+	return uses;
+}
+
+liveness compiler::ir::build_liveness(const function& fn)
+{
+	const auto count = fn.blocks.size();
+
+	liveness live;
+	live.live_in.resize(count);
+	live.live_out.resize(count);
+
+	// 各块最近一次加入的值，值按编号升序处理，据此去重并保持集合有序
+	std::vector<value_id> last_in(count, no_value), last_out(count, no_value);
+	std::vector<block_id> stack;
+
+	auto add_out = [&](block_id block, value_id value)
+	{
+		if (last_out[block] == value) return;
+
+		last_out[block] = value;
+		live.live_out[block].push_back(value);
+	};
+
+	// 值在 block 入口活跃：沿前驱上溯至定义块
+	auto walk_up = [&](block_id block, value_id value)
+	{
+		const block_id definition = fn.values[value].block;
+		stack.push_back(block);
+
+		while (!stack.empty())
+		{
+			const auto current = stack.back();
+			stack.pop_back();
+
+			if (current == definition || last_in[current] == value) continue;
+
+			last_in[current] = value;
+			live.live_in[current].push_back(value);
+
+			for (const auto predecessor : fn.blocks[current].predecessors)
+			{
+				add_out(predecessor, value);
+				stack.push_back(predecessor);
+			}
+		}
+	};
+
+	const auto uses = build_uses(fn);
+
+	for (value_id value = 0; value < fn.values.size(); value++)
+	{
+		const auto& inst = fn.values[value];
+		if (inst.code == opcode::nop || inst.block == no_block) continue;
+
+		for (const auto user : uses.users_of(value))
+		{
+			const auto& use = fn.values[user];
+
+			if (use.code == opcode::phi)
+			{
+				// φ 的操作数在对应前驱的出口处使用
+				const auto operands = fn.operands_of(user);
+				const auto& predecessors = fn.blocks[use.block].predecessors;
+
+				for (size_t i = 0; i < operands.size(); i++)
+					if (operands[i] == value)
+					{
+						add_out(predecessors[i], value);
+						walk_up(predecessors[i], value);
+					}
+			}
+			else if (use.block != inst.block)
+				walk_up(use.block, value);
+		}
+	}
+
+	return live;
+}
+
+bool compiler::ir::remove_trivial_phis(function& fn)
+{
+	std::vector<value_id> forward(fn.values.size());
+	for (value_id i = 0; i < forward.size(); i++) forward[i] = i;
+
+	auto find = [&](value_id value)
+	{
+		while (forward[value] != value)
+		{
+			forward[value] = forward[forward[value]];
+			value = forward[value];
+		}
+
+		return value;
+	};
+
+	bool removed = false;
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+
+		for (auto& block : fn.blocks)
+			for (const auto phi : block.phis)
+			{
+				if (fn.values[phi].code != opcode::phi) continue;
+
+				value_id same = no_value;
+				bool trivial = true;
+
+				for (const auto use : fn.operands_of(phi))
+				{
+					const auto value = find(use);
+					if (value == phi || value == same) continue;
+
+					if (same != no_value)
+					{
+						trivial = false;
+						break;
+					}
+
+					same = value;
+				}
+
+				if (!trivial || same == no_value) continue;
+
+				forward[phi] = same;
+				fn.values[phi].code = opcode::nop;
+				changed = removed = true;
+			}
+	}
+
+	if (!removed) return false;
+
+	for (auto& block : fn.blocks)
+		std::erase_if(block.phis, [&](value_id phi) { return fn.values[phi].code == opcode::nop; });
+
+	for (value_id i = 0; i < fn.values.size(); i++)
+		if (fn.values[i].code != opcode::nop)
+			fn.for_each_operand(i, [&](value_id& use) { use = find(use); });
+
+	return true;
+}
+
+void compiler::ir::compact_blocks(function& fn, const std::vector<bool>& removed)
+{
+	std::vector<block_id> remap(fn.blocks.size(), no_block);
+	block_id count = 0;
+
+	for (block_id b = 0; b < fn.blocks.size(); b++)
+	{
+		if (!removed[b])
+		{
+			remap[b] = count++;
+			continue;
+		}
+
+		for (const auto id : fn.blocks[b].phis) fn.values[id].code = opcode::nop;
+		for (const auto id : fn.blocks[b].code) fn.values[id].code = opcode::nop;
+	}
+
+	std::vector<basic_block> blocks;
+	blocks.reserve(count);
+
+	for (block_id b = 0; b < fn.blocks.size(); b++)
+	{
+		if (removed[b]) continue;
+
+		auto& block = fn.blocks[b];
+
+		for (const auto id : block.phis) fn.values[id].block = remap[b];
+		for (const auto id : block.code) fn.values[id].block = remap[b];
+
+		for (auto& predecessor : block.predecessors) predecessor = remap[predecessor];
+		for (auto& successor : block.successors) successor = remap[successor];
+
+		if (const auto terminator = block.terminator(fn.values); terminator != no_value)
+		{
+			auto& inst = fn.values[terminator];
+
+			if (inst.code == opcode::jump)
+				inst.a = remap[inst.a];
+			else if (inst.code == opcode::branch)
+			{
+				inst.b = remap[inst.b];
+				inst.c = remap[inst.c];
+			}
+		}
+
+		blocks.push_back(std::move(block));
+	}
+
+	fn.blocks = std::move(blocks);
+}
+
+namespace
+{
+	// 降低过程的状态，同一程序的各函数共用以复用缓冲区
+	// 变量编号在整个语法树内唯一，各函数的局部变量互不重叠，按变量编号索引的数组无需在函数之间清空
+	struct lowering
+	{
+		const syntax_tree& tree;
+		std::unordered_map<symbol_id, uint32_t> callees; // 函数名 -> 首个定义
+
+		function fn;
+		block_id current = 0;
+		bool reachable = true; // 当前位置是否可达，返回之后或两侧均已返回的 if 之后不可达
+		node_index base = 0; // 当前函数首个节点的编号
+
+		std::vector<value_id> current_def; // 局部变量当前的 SSA 值，按变量编号索引
+		std::vector<std::pair<variable_index, value_id>> undo; // 每次写入前的旧值，用于在 if 分支之间回退
+		std::vector<std::pair<variable_index, value_id>> merges; // 尚未汇合的 if 分支中变化的变量及其在分支末尾的值
+		std::vector<value_id> arm_value; // 汇合时 if 主体中变量的值，按变量编号索引
+		std::vector<uint32_t> stamp; // 收集变化的变量时去重
+		uint32_t generation = 0;
+
+		std::vector<std::pair<variable_index, value_id>> loop_phis; // 尚未结束的循环的头部 φ，循环体结束后补上回边流入的值
+		std::vector<variable_index> loop_variables;
+		std::vector<statement_range> scan;
+
+		std::vector<value_id> lowered; // 当前函数中不读取全局变量与内存的节点 -> 值
+		std::vector<std::pair<node_index, bool>> pending; // 表达式的显式栈：节点及其子节点是否已入栈
+		std::vector<value_id> results; // 已降低的操作数
+		std::vector<bool> pure; // 与 results 对应：是否只依赖局部变量与常量
+		std::vector<value_id> arguments;
+
+		// 尚未结束的语句块；if 的主体与 else 部分先后使用同一帧
+		struct frame
+		{
+			uint32_t next = 0, end = 0;
+			statement_index branch = invalid_statement; // 所属 if 语句
+			statement_index loop = invalid_statement; // 所属 while 循环；两者均为 invalid_statement 时为函数体
+			bool in_else = false;
+
+			block_id else_block = no_block, join = no_block; // join：if 的汇合块或循环的出口
+			block_id header = no_block; // 循环头部，每轮求值条件
+			block_id then_end = no_block; // 主体结束时所在的块
+			bool then_live = false; // 主体结束时是否仍可流向汇合块
+
+			uint32_t undo_mark = 0, merge_mark = 0, then_count = 0, phi_mark = 0;
+		};
+
+		std::vector<frame> frames;
+
+	public:
+		lowering(const syntax_tree& tree) : tree(tree)
+		{
+			for (uint32_t i = 0; i < tree.functions.size(); i++)
+				callees.try_emplace(tree.functions[i].name, i);
+
+			current_def.assign(tree.variables.size(), no_value);
+			arm_value.assign(tree.variables.size(), no_value);
+			stamp.assign(tree.variables.size(), 0);
+		}
+
+		value_id emit(opcode code, number_type type, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0, operand_type op = operand_type::none)
+		{
+			return fn.append(current, instruction{ code, op, type, no_block, a, b, c });
+		}
+
+		block_id new_block()
+		{
+			fn.blocks.emplace_back();
+			return block_id(fn.blocks.size() - 1);
+		}
+
+		void jump(block_id target)
+		{
+			emit(opcode::jump, number_type::none, target);
+			fn.link(current, target);
+		}
+
+		// 当前块能否继续执行到下一条语句
+		bool live() const
+		{
+			return reachable && fn.blocks[current].terminator(fn.values) == no_value;
+		}
+
+		// 将值转换为 type，常量直接折叠
+		value_id convert_to(value_id value, number_type type)
+		{
+			const auto& inst = fn.values[value];
+			if (type == number_type::none || inst.type == number_type::none || inst.type == type) return value;
+
+			if (inst.code == opcode::constant)
+			{
+				number_union data;
+				data.uint_number = inst.a;
+
+				const auto folded = constant_folding::convert({ inst.type, data }, type);
+				return emit(opcode::constant, type, folded.value.uint_number);
+			}
+
+			return emit(opcode::convert, type, value);
+		}
+
+		value_id read(variable_index variable)
+		{
+			const auto& info = tree.variables[variable];
+
+			if (info.global)
+				return emit(opcode::load_global, info.val_type, variable);
+
+			if (current_def[variable] == no_value) // 名称解析已保证先声明后使用，此处仅作保护
+				current_def[variable] = emit(opcode::undefined, info.val_type);
+
+			return current_def[variable];
+		}
+
+		void write(variable_index variable, value_id value)
+		{
+			const auto& info = tree.variables[variable];
+			value = convert_to(value, info.val_type);
+
+			if (info.global)
+			{
+				emit(opcode::store_global, number_type::none, variable, value);
+				return;
+			}
+
+			undo.push_back({ variable, current_def[variable] });
+			current_def[variable] = value;
+		}
+
+		// 降低节点，children 为各子节点的值
+		value_id lower_node(node_index index, const value_id* children)
+		{
+			const auto& node = tree[index];
+
+			switch (node.node_type)
+			{
+			case node_value::node_constant:
+				return emit(opcode::constant, node.number_type, node.value.uint_number);
+
+			case node_value::node_identifier:
+				return read(variable_index(node.left));
+
+			case node_value::node_function:
+			{
+				const auto callee = callees.find(node.identifier);
+				const function_definition* definition = callee != callees.end() ? &tree.functions[callee->second] : nullptr;
+
+				// 实参转换为形参的类型
+				arguments.clear();
+
+				const auto parameters = tree.parameters_of(index);
+				for (uint32_t i = 0; i < parameters.size(); i++)
+				{
+					const auto argument = children[i];
+
+					if (definition && i < definition->parameters.count)
+						arguments.push_back(convert_to(argument, tree.declarements[definition->parameters.begin + i].type));
+					else
+						arguments.push_back(argument);
+				}
+
+				const auto id = emit(opcode::call, definition ? definition->return_type : number_type::none, node.identifier);
+				fn.set_operands(id, arguments);
+				return id;
+			}
+
+			default:
+				break;
+			}
+
+			// 前缀运算
+			if (node.right == invalid_node)
+			{
+				const auto operand = children[0];
+
+				if (node.op_type == operand_type::get_address)
+					return emit(opcode::load, number_type::integer, operand);
+
+				return emit(opcode::unary, fn.values[operand].type, operand, 0, 0, node.op_type);
+			}
+
+			// 二元运算：移位取左操作数的类型，其余统一到公共类型，比较的结果为有符号整数
+			auto left = children[0], right = children[1];
+			number_type type = fn.values[left].type;
+
+			if (!constant_folding::is_shift(node.op_type))
+			{
+				type = constant_folding::common_type(type, fn.values[right].type);
+				left = convert_to(left, type);
+				right = convert_to(right, type);
+			}
+
+			if (constant_folding::is_comparison(node.op_type))
+				type = number_type::integer;
+
+			return emit(opcode::binary, type, left, right, 0, node.op_type);
+		}
+
+		// 以显式栈按后序降低表达式，右子节点先入栈，使各操作数按从左到右的顺序求值
+		// 同一语句中共享的子表达式若只依赖局部变量与常量则只降低一次；读取全局变量、内存或含调用的子表达式在每处使用时重新降低，
+		// 因为先求值的调用可能改写全局变量与内存
+		value_id lower_expression(node_index root)
+		{
+			pending.push_back({ root, false });
+
+			while (!pending.empty())
+			{
+				const auto [index, expanded] = pending.back();
+				pending.pop_back();
+
+				const auto& node = tree[index];
+				size_t arity = 0;
+
+				if (node.node_type == node_value::node_operator)
+					arity = node.right == invalid_node ? 1 : 2;
+				else if (node.node_type == node_value::node_function)
+					arity = node.right;
+
+				if (!expanded)
+				{
+					if (const auto value = lowered[index - base]; value != no_value)
+					{
+						results.push_back(value);
+						pure.push_back(true);
+						continue;
+					}
+
+					pending.push_back({ index, true });
+
+					if (node.node_type == node_value::node_operator)
+					{
+						if (arity == 2) pending.push_back({ node.right, false });
+						pending.push_back({ node.left, false });
+					}
+					else if (node.node_type == node_value::node_function)
+					{
+						const auto parameters = tree.parameters_of(index);
+						for (size_t i = parameters.size(); i-- > 0;)
+							pending.push_back({ parameters[i], false });
+					}
+
+					continue;
+				}
+
+				const size_t first = results.size() - arity;
+
+				bool is_pure = node.node_type == node_value::node_constant
+					|| (node.node_type == node_value::node_identifier && !tree.variables[node.left].global)
+					|| (node.node_type == node_value::node_operator && node.op_type != operand_type::get_address);
+
+				for (size_t i = first; i < results.size(); i++)
+					is_pure = is_pure && pure[i];
+
+				const auto value = lower_node(index, results.data() + first);
+
+				results.resize(first);
+				pure.resize(first);
+				results.push_back(value);
+				pure.push_back(is_pure);
+
+				if (is_pure) lowered[index - base] = value;
+			}
+
+			const auto value = results.back();
+			results.pop_back();
+			pure.pop_back();
+			return value;
+		}
+
+		// 收集 undo_mark 以来变化的变量及其当前值并记入 merges，再回退到分支之前，返回收集的个数
+		uint32_t collect_arm(uint32_t undo_mark)
+		{
+			const size_t begin = merges.size();
+			generation++;
+
+			for (size_t i = undo_mark; i < undo.size(); i++)
+			{
+				const auto variable = undo[i].first;
+				if (stamp[variable] == generation) continue;
+
+				stamp[variable] = generation;
+				merges.push_back({ variable, current_def[variable] });
+			}
+
+			rollback(undo_mark);
+			return uint32_t(merges.size() - begin);
+		}
+
+		// 撤销 undo_mark 以来的写入
+		void rollback(uint32_t undo_mark)
+		{
+			for (size_t i = undo.size(); i-- > undo_mark;)
+				current_def[undo[i].first] = undo[i].second;
+
+			undo.resize(undo_mark);
+		}
+
+		// 在汇合块中合并 if 两侧的变量：只有一侧可达时直接取其值，两侧的值不同时插入 φ
+		void merge(const frame& branch, bool else_live)
+		{
+			current = branch.join;
+
+			if (branch.then_live || else_live)
+			{
+				auto merge_variable = [&](variable_index variable, value_id then_value, value_id else_value)
+				{
+					const auto before = current_def[variable];
+					if (before == no_value) return; // 在分支内声明的变量
+
+					if (then_value == no_value) then_value = before;
+					if (else_value == no_value) else_value = before;
+
+					value_id value = !branch.then_live ? else_value : !else_live ? then_value : then_value == else_value ? then_value : no_value;
+
+					if (value == no_value)
+					{
+						value = emit(opcode::phi, tree.variables[variable].val_type);
+
+						arguments.clear();
+						for (const auto predecessor : fn.blocks[current].predecessors)
+							arguments.push_back(predecessor == branch.then_end ? then_value : else_value);
+
+						fn.set_operands(value, arguments);
+					}
+
+					if (value != before) write(variable, value);
+				};
+
+				const uint32_t then_begin = branch.merge_mark, else_begin = branch.merge_mark + branch.then_count;
+				const auto else_end_index = uint32_t(merges.size());
+
+				for (uint32_t i = then_begin; i < else_begin; i++)
+					arm_value[merges[i].first] = merges[i].second;
+
+				for (uint32_t i = else_begin; i < else_end_index; i++)
+				{
+					const auto variable = merges[i].first;
+					merge_variable(variable, arm_value[variable], merges[i].second);
+					arm_value[variable] = no_value;
+				}
+
+				for (uint32_t i = then_begin; i < else_begin; i++)
+				{
+					const auto variable = merges[i].first;
+					if (arm_value[variable] == no_value) continue;
+
+					merge_variable(variable, arm_value[variable], no_value);
+					arm_value[variable] = no_value;
+				}
+			}
+
+			merges.resize(branch.merge_mark);
+			reachable = branch.then_live || else_live;
+		}
+
+		// 收集循环体（含嵌套的语句块）中被赋值、且在循环之前已声明的局部变量，存入 loop_variables
+		void collect_loop_variables(const while_loop& loop)
+		{
+			loop_variables.clear();
+			generation++;
+			scan.assign(1, loop.body);
+
+			while (!scan.empty())
+			{
+				const auto range = scan.back();
+				scan.pop_back();
+
+				for (const auto& statement : tree.block(range))
+				{
+					switch (statement.statement_type)
+					{
+					case statement_wrapper::assign:
+					{
+						const auto& assign = tree.assignments[statement.index];
+						if (assign.type != assignment::variable) break;
+
+						const auto variable = assign.var_index;
+						if (tree.variables[variable].global || current_def[variable] == no_value || stamp[variable] == generation) break;
+
+						stamp[variable] = generation;
+						loop_variables.push_back(variable);
+						break;
+					}
+
+					case statement_wrapper::if_statement:
+						scan.push_back(tree.branches[statement.index].body);
+						scan.push_back(tree.branches[statement.index].else_body);
+						break;
+
+					case statement_wrapper::while_loop:
+						scan.push_back(tree.loops[statement.index].body);
+						break;
+
+					default:
+						break;
+					}
+				}
+			}
+		}
+
+		// 进入循环：跳转到头部，为循环体中被赋值的变量插入只有入口一侧操作数的 φ，再求值条件并分支到循环体或出口
+		frame begin_loop(statement_index index)
+		{
+			const auto& loop = tree.loops[index];
+			collect_loop_variables(loop);
+
+			frame next;
+			next.next = loop.body.begin;
+			next.end = loop.body.begin + loop.body.count;
+			next.loop = index;
+
+			next.header = new_block();
+			jump(next.header);
+			current = next.header;
+
+			next.phi_mark = uint32_t(loop_phis.size());
+
+			for (const auto variable : loop_variables)
+			{
+				const value_id entry = current_def[variable];
+				const auto phi = emit(opcode::phi, tree.variables[variable].val_type);
+
+				fn.set_operands(phi, std::span<const value_id>(&entry, 1));
+				write(variable, phi);
+				loop_phis.push_back({ variable, phi });
+			}
+
+			const auto condition = lower_expression(loop.condition);
+			const block_id body = new_block();
+			next.join = new_block();
+
+			emit(opcode::branch, number_type::none, condition, body, next.join);
+			fn.link(current, body);
+			fn.link(current, next.join);
+
+			next.undo_mark = uint32_t(undo.size());
+			current = body;
+			return next;
+		}
+
+		// 循环体结束：仍可执行到末尾时跳回头部，并补上 φ 自回边流入的值；其后自出口继续，变量取头部 φ 的值
+		void end_loop(const frame& loop)
+		{
+			const bool body_live = live();
+			if (body_live) jump(loop.header);
+
+			if (body_live)
+				for (size_t i = loop.phi_mark; i < loop_phis.size(); i++)
+				{
+					const auto [variable, phi] = loop_phis[i];
+					const value_id incoming[] = { fn.operands_of(phi)[0], current_def[variable] };
+
+					fn.set_operands(phi, incoming);
+				}
+
+			loop_phis.resize(loop.phi_mark);
+			rollback(loop.undo_mark);
+
+			current = loop.join;
+			reachable = true;
+		}
+
+		function lower(uint32_t definition)
+		{
+			const auto& source = tree.functions[definition];
+
+			fn = function();
+			fn.definition = definition;
+			fn.name = source.name;
+			fn.return_type = source.return_type;
+			fn.parameter_count = source.parameters.count;
+
+			base = source.node_begin;
+			lowered.assign(size_t(source.node_end - source.node_begin), no_value);
+			fn.values.reserve(lowered.size()); // 指令数与节点数相近
+
+			current = new_block();
+			reachable = true;
+
+			for (uint32_t i = 0; i < source.parameters.count; i++)
+			{
+				const auto& parameter = tree.declarements[source.parameters.begin + i];
+				write(parameter.variable, emit(opcode::parameter, parameter.type, i));
+			}
+
+			frames.push_back({ source.body.begin, source.body.begin + source.body.count });
+
+			while (!frames.empty())
+			{
+				auto& top = frames.back();
+
+				if (top.next == top.end)
+				{
+					if (top.loop != invalid_statement)
+					{
+						end_loop(top);
+						frames.pop_back();
+						continue;
+					}
+
+					if (top.branch == invalid_statement)
+					{
+						frames.pop_back();
+						continue;
+					}
+
+					const auto& branch = tree.branches[top.branch];
+					const block_id arm_end = current;
+					const bool arm_live = live();
+					const uint32_t count = collect_arm(top.undo_mark);
+
+					if (arm_live) jump(top.join);
+
+					if (!top.in_else)
+					{
+						top.then_end = arm_end;
+						top.then_live = arm_live;
+						top.then_count = count;
+
+						if (branch.else_body.count)
+						{
+							top.in_else = true;
+							top.next = branch.else_body.begin;
+							top.end = branch.else_body.begin + branch.else_body.count;
+							current = top.else_block;
+							reachable = true;
+							continue;
+						}
+
+						// 无 else：条件不成立时自分支前的块直接流向汇合块
+						merge(top, true);
+					}
+					else
+						merge(top, arm_live);
+
+					frames.pop_back();
+
+					// 两侧均已返回：本块其余的语句不可达，不再降低
+					if (!reachable) frames.back().next = frames.back().end;
+					continue;
+				}
+
+				const auto statement = tree.statements[top.next++];
+
+				switch (statement.statement_type)
+				{
+				case statement_wrapper::decl:
+				{
+					const auto& decl = tree.declarements[statement.index];
+					write(decl.variable, emit(opcode::undefined, decl.type));
+					break;
+				}
+
+				case statement_wrapper::assign:
+				{
+					const auto& assign = tree.assignments[statement.index];
+
+					if (assign.type == assignment::variable)
+						write(assign.var_index, lower_expression(assign.right));
+					else
+					{
+						const auto address = lower_expression(assign.left);
+						emit(opcode::store, number_type::none, address, lower_expression(assign.right));
+					}
+					break;
+				}
+
+				case statement_wrapper::if_statement:
+				{
+					const auto& branch = tree.branches[statement.index];
+					const auto condition = lower_expression(branch.condition);
+
+					frame next;
+					next.next = branch.body.begin;
+					next.end = branch.body.begin + branch.body.count;
+					next.branch = statement.index;
+
+					const block_id then_block = new_block();
+					next.else_block = branch.else_body.count ? new_block() : no_block;
+					next.join = new_block();
+
+					const block_id otherwise = branch.else_body.count ? next.else_block : next.join;
+					emit(opcode::branch, number_type::none, condition, then_block, otherwise);
+					fn.link(current, then_block);
+					fn.link(current, otherwise);
+
+					next.undo_mark = uint32_t(undo.size());
+					next.merge_mark = uint32_t(merges.size());
+
+					current = then_block;
+					frames.push_back(next); // top 此后失效
+					break;
+				}
+
+				case statement_wrapper::while_loop:
+					frames.push_back(begin_loop(statement.index)); // top 此后失效
+					break;
+
+				case statement_wrapper::return_statement:
+				{
+					value_id value = no_value;
+
+					if (statement.index != invalid_node)
+						value = convert_to(lower_expression(statement.index), fn.return_type);
+
+					emit(opcode::ret, number_type::none, value);
+
+					// 本块其余的语句不可达，不再降低
+					reachable = false;
+					top.next = top.end;
+					break;
+				}
+
+				default:
+					break;
+				}
+			}
+
+			if (live())
+				emit(opcode::ret, number_type::none, no_value);
+
+			// 两侧均已返回的 if 的汇合块没有前驱，同样以返回结束，使每个块都有结束指令
+			for (block_id i = 0; i < fn.blocks.size(); i++)
+				if (fn.blocks[i].terminator(fn.values) == no_value)
+				{
+					current = i;
+					emit(opcode::ret, number_type::none, no_value);
+				}
+
+			remove_trivial_phis(fn);
+
+			// 本函数的局部变量此后不再使用，恢复为未定义以便下一个函数复用
+			for (const auto& [variable, previous] : undo)
+				current_def[variable] = no_value;
+
+			undo.clear();
+			return std::move(fn);
+		}
+	};
+}
+
+function compiler::ir::lower_function(const syntax_tree& tree, uint32_t definition)
+{
+	lowering state(tree);
+	return state.lower(definition);
+}
+
+module compiler::ir::lower_program(const syntax_tree& tree)
+{
+	module program;
+
+	// 全局变量：初值只能是常量，在声明之后以赋值给出
+	std::unordered_map<variable_index, uint32_t> global_of;
+
+	for (const auto& statement : tree.block(tree.globals))
+	{
+		if (statement.statement_type == statement_wrapper::decl)
+		{
+			const auto& decl = tree.declarements[statement.index];
+
+			global_of[decl.variable] = uint32_t(program.globals.size());
+			program.globals.push_back({ decl.variable, decl.type, {} });
+		}
+		else if (statement.statement_type == statement_wrapper::assign)
+		{
+			const auto& assign = tree.assignments[statement.index];
+			const auto global = global_of.find(assign.var_index);
+			const auto& node = tree[assign.right];
+
+			if (global == global_of.end() || node.node_type != node_value::node_constant) continue;
+
+			auto& target = program.globals[global->second];
+			target.value = constant_folding::convert({ node.number_type, node.value }, target.type).value;
+		}
+	}
+
+	lowering state(tree);
+
+	for (uint32_t i = 0; i < tree.functions.size(); i++)
+		if (tree.functions[i].parsed)
+			program.functions.push_back(state.lower(i));
+
+	return program;
+}
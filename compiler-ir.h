@@ -0,0 +1,295 @@
+// compiler-ir.h: SSA 中间表示、自语法树的降低与支配树
+
+#pragma once
+
+#include "compiler-head.h"
+#include "compiler-base.h"
+
+namespace compiler::ir
+{
+	// 值编号：指令在 function::values 中的下标，即该指令结果的 SSA 值
+	using value_id = uint32_t;
+	constexpr value_id no_value = std::numeric_limits<value_id>::max();
+
+	// 基本块编号：基本块在 function::blocks 中的下标，0 为入口
+	using block_id = uint32_t;
+	constexpr block_id no_block = std::numeric_limits<block_id>::max();
+
+	// 操作码，各指令的 a、b、c 含义见注释
+	enum class opcode : uint8_t
+	{
+		nop, // 已删除的指令
+		constant, // a：常量的数据位
+		undefined, // 未初始化的变量
+		parameter, // a：形参序号
+		binary, // op：运算符；a、b：左右操作数
+		unary, // op：运算符（bit_not）；a：操作数
+		convert, // a：操作数，转换为 type
+		load, // a：地址；读取内存
+		store, // a：地址；b：值；写入内存
+		load_global, // a：全局变量在 syntax_tree::variables 中的编号
+		store_global, // a：全局变量编号；b：值
+		call, // a：函数名；实参为 operands[b, b + c)
+		phi, // 各前驱流入的值为 operands[b, b + c)，顺序与 basic_block::predecessors 一致
+		jump, // a：目标块
+		branch, // a：条件，非零时转至块 b，否则转至块 c
+		ret // a：返回值，无返回值时为 no_value
+	};
+
+	// 指令：各类操作数统一存放于 a、b、c，按值连续存放于 function::values
+	struct instruction
+	{
+		opcode code = opcode::nop;
+		operand_type op = operand_type::none;
+		number_type type = number_type::none; // 结果类型，无结果或类型未知时为 none
+
+		block_id block = no_block; // 所在基本块
+		uint32_t a = 0, b = 0, c = 0;
+
+	public:
+		// 是否为结束基本块的跳转、分支或返回
+		inline bool is_terminator() const
+		{
+			return code == opcode::jump || code == opcode::branch || code == opcode::ret;
+		}
+
+		// 是否有除产生结果以外的作用，不可删除或重排
+		inline bool has_side_effect() const
+		{
+			return code == opcode::store || code == opcode::store_global || code == opcode::call || is_terminator();
+		}
+
+		// 是否读取内存或全局变量，结果随其间的写入而变
+		inline bool reads_memory() const
+		{
+			return code == opcode::load || code == opcode::load_global;
+		}
+	};
+
+	static_assert(sizeof(instruction) == 20, "instruction should stay 20 bytes");
+
+	// 基本块：φ 指令与其余指令分别按执行顺序记录值编号，其余指令以跳转、分支或返回结束
+	struct basic_block
+	{
+		std::vector<value_id> phis;
+		std::vector<value_id> code;
+
+		std::vector<block_id> predecessors;
+		std::vector<block_id> successors;
+
+	public:
+		// 结束本块的指令，尚未结束时为 no_value
+		inline value_id terminator(const std::vector<instruction>& values) const
+		{
+			return !code.empty() && values[code.back()].is_terminator() ? code.back() : no_value;
+		}
+	};
+
+	// 函数：全部指令存放于 values，基本块只记录指令编号；phi 与 call 的变长操作数存放于 operands
+	struct function
+	{
+		uint32_t definition = 0; // 在 syntax_tree::functions 中的编号
+		symbol_id name = 0;
+		number_type return_type = number_type::none;
+		uint32_t parameter_count = 0;
+
+		std::vector<instruction> values;
+		std::vector<value_id> operands;
+		std::vector<basic_block> blocks;
+
+	public:
+		// 追加指令，返回其值编号
+		inline value_id add(block_id block, instruction inst)
+		{
+			inst.block = block;
+			values.push_back(inst);
+			return value_id(values.size() - 1);
+		}
+
+		// 追加指令并放在块末尾
+		inline value_id append(block_id block, instruction inst)
+		{
+			const auto id = add(block, inst);
+			(inst.code == opcode::phi ? blocks[block].phis : blocks[block].code).push_back(id);
+			return id;
+		}
+
+		// phi 或 call 的变长操作数
+		inline std::span<value_id> operands_of(value_id id)
+		{
+			return std::span<value_id>(operands.data() + values[id].b, values[id].c);
+		}
+
+		inline std::span<const value_id> operands_of(value_id id) const
+		{
+			return std::span<const value_id>(operands.data() + values[id].b, values[id].c);
+		}
+
+		// 以 uses 替换 phi 或 call 的变长操作数：追加到 operands 末尾，原区间作废
+		void set_operands(value_id id, std::span<const value_id> uses);
+
+		// 对指令的每个值操作数调用 visit(value_id&)，常量函数上为 visit(const value_id&)
+		template<class visitor>
+		void for_each_operand(value_id id, visitor&& visit)
+		{
+			visit_operands(*this, id, visit);
+		}
+
+		template<class visitor>
+		void for_each_operand(value_id id, visitor&& visit) const
+		{
+			visit_operands(*this, id, visit);
+		}
+
+		// 连接两个基本块
+		inline void link(block_id from, block_id to)
+		{
+			blocks[from].successors.push_back(to);
+			blocks[to].predecessors.push_back(from);
+		}
+
+	private:
+		template<class self_type, class visitor>
+		static void visit_operands(self_type& self, value_id id, visitor& visit)
+		{
+			auto& inst = self.values[id];
+
+			switch (inst.code)
+			{
+			case opcode::binary:
+			case opcode::store:
+				visit(inst.a);
+				visit(inst.b);
+				break;
+
+			case opcode::unary:
+			case opcode::convert:
+			case opcode::load:
+			case opcode::branch:
+				visit(inst.a);
+				break;
+
+			case opcode::store_global:
+				visit(inst.b);
+				break;
+
+			case opcode::ret:
+				if (inst.a != no_value) visit(inst.a);
+				break;
+
+			case opcode::call:
+			case opcode::phi:
+				for (auto& use : self.operands_of(id)) visit(use);
+				break;
+
+			default:
+				break;
+			}
+		}
+	};
+
+	// 全局变量及其常量初值
+	struct global_variable
+	{
+		variable_index variable = invalid_variable;
+		number_type type = number_type::none;
+		number_union value; // 无初值时为 0
+	};
+
+	// 整个程序：全局变量与已解析函数体的函数
+	struct module
+	{
+		std::vector<global_variable> globals;
+		std::vector<function> functions;
+	};
+
+	// 支配树，以 Cooper、Harvey 与 Kennedy 的迭代算法按逆后序求直接支配者
+	struct dominator_tree
+	{
+		std::vector<block_id> idom; // 直接支配者，入口为自身，不可达的块为 no_block
+		std::vector<block_id> order; // 可达块的逆后序
+
+		// 支配树的子节点，块 b 的子节点为 children[child_begin[b], child_begin[b + 1])
+		std::vector<uint32_t> child_begin;
+		std::vector<block_id> children;
+
+		// 支配树先序遍历的进入与离开序号，用于 O(1) 判断支配关系
+		std::vector<uint32_t> enter, leave;
+
+	public:
+		inline bool reachable(block_id block) const
+		{
+			return idom[block] != no_block;
+		}
+
+		// a 是否支配 b（含 a == b）
+		inline bool dominates(block_id a, block_id b) const
+		{
+			return reachable(a) && reachable(b) && enter[a] <= enter[b] && leave[b] <= leave[a];
+		}
+
+		inline std::span<const block_id> children_of(block_id block) const
+		{
+			return std::span<const block_id>(children.data() + child_begin[block], child_begin[block + 1] - child_begin[block]);
+		}
+	};
+
+	// 使用链：值 v 的使用者为 users[user_begin[v], user_begin[v + 1])，同一指令多次使用时重复出现
+	struct use_list
+	{
+		std::vector<uint32_t> user_begin;
+		std::vector<value_id> users;
+
+	public:
+		inline std::span<const value_id> users_of(value_id value) const
+		{
+			return std::span<const value_id>(users.data() + user_begin[value], user_begin[value + 1] - user_begin[value]);
+		}
+
+		inline bool used(value_id value) const
+		{
+			return user_begin[value] != user_begin[value + 1];
+		}
+	};
+
+	// 活跃性：各块入口与出口处活跃的值，按值编号升序存放
+	// 块入口不含本块 φ 的结果，φ 的操作数视为在对应前驱的出口处使用；只在定义块内使用的值不出现
+	struct liveness
+	{
+		std::vector<std::vector<value_id>> live_in, live_out;
+
+	public:
+		inline bool is_live_in(block_id block, value_id value) const
+		{
+			return std::binary_search(live_in[block].begin(), live_in[block].end(), value);
+		}
+
+		inline bool is_live_out(block_id block, value_id value) const
+		{
+			return std::binary_search(live_out[block].begin(), live_out[block].end(), value);
+		}
+	};
+
+	// 构建支配树
+	dominator_tree build_dominators(const function& fn);
+
+	// 构建使用链，只统计基本块中的指令
+	use_list build_uses(const function& fn);
+
+	// 构建活跃性：自每个跨块的使用沿前驱上溯至定义块，代价与活跃范围的总大小成正比
+	liveness build_liveness(const function& fn);
+
+	// 消去平凡的 φ：除自身外只流入同一个值的 φ 以该值代替，迭代至不动点后统一改写操作数；有删除时返回 true
+	bool remove_trivial_phis(function& fn);
+
+	// 删除 removed 标记的块并压缩编号，块中的指令一并删除；保留的块不应再与被删除的块相连
+	void compact_blocks(function& fn, const std::vector<bool>& removed);
+
+	// 降低：将已解析的函数体转换为 SSA 形式
+	// 局部变量与形参直接以 SSA 值表示，在 if 分支的汇合处与 while 循环的头部插入 φ，平凡的 φ 在构造结束后消去
+	// 全局变量通过 load_global/store_global 访问，@ 读写内存；要求名称解析已完成且没有诊断
+	function lower_function(const syntax_tree& tree, uint32_t definition);
+
+	// 降低整个程序中全部已解析的函数
+	module lower_program(const syntax_tree& tree);
+}
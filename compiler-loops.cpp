@@ -0,0 +1,529 @@
+// compiler-loops.cpp: 循环不变量外提与循环展开
+
+#include "compiler-loops.h"
+#include "compiler-constant-folding.h"
+
+using namespace compiler;
+using namespace compiler::ir;
+
+namespace
+{
+	constexpr uint32_t max_simulated_trips = 4096; // 模拟求执行次数的轮数上限
+
+	// 自然循环：头部支配回边的起点，循环由不经头部即可到达回边起点的块组成
+	struct natural_loop
+	{
+		block_id header = no_block;
+		block_id preheader = no_block; // 唯一的循环外前驱且只流向头部，否则为 no_block
+		std::vector<block_id> blocks; // 含头部，按逆后序排列
+	};
+
+	// 单块循环：头部求值条件后分支到循环体或出口，循环体跳回头部
+	struct simple_loop
+	{
+		block_id header = no_block, body = no_block, exit = no_block;
+		uint32_t entry = 0, latch = 0; // 入口与回边在头部前驱中的下标
+	};
+
+	std::vector<uint32_t> rpo_numbers(const function& fn, const dominator_tree& dominators)
+	{
+		std::vector<uint32_t> number(fn.blocks.size(), UINT32_MAX);
+
+		for (uint32_t i = 0; i < dominators.order.size(); i++)
+			number[dominators.order[i]] = i;
+
+		return number;
+	}
+
+	// 按头部逆后序的倒序列出全部自然循环，内层循环先于外层；同一头部的多条回边合为一个循环
+	std::vector<natural_loop> find_loops(const function& fn, const dominator_tree& dominators, const std::vector<uint32_t>& rpo_number)
+	{
+		std::vector<natural_loop> loops;
+		std::vector<uint32_t> visited(fn.blocks.size(), UINT32_MAX); // 最近一次加入的循环
+		std::vector<block_id> stack;
+
+		for (size_t i = dominators.order.size(); i-- > 0;)
+		{
+			const auto header = dominators.order[i];
+
+			for (const auto predecessor : fn.blocks[header].predecessors)
+				if (dominators.dominates(header, predecessor))
+					stack.push_back(predecessor);
+
+			if (stack.empty()) continue;
+
+			const auto number = uint32_t(loops.size());
+
+			natural_loop loop;
+			loop.header = header;
+			loop.blocks.push_back(header);
+			visited[header] = number;
+
+			// 自回边起点沿前驱上溯至头部
+			while (!stack.empty())
+			{
+				const auto block = stack.back();
+				stack.pop_back();
+
+				if (visited[block] == number || !dominators.reachable(block)) continue;
+
+				visited[block] = number;
+				loop.blocks.push_back(block);
+
+				for (const auto predecessor : fn.blocks[block].predecessors)
+					stack.push_back(predecessor);
+			}
+
+			std::sort(loop.blocks.begin(), loop.blocks.end(), [&](block_id a, block_id b) { return rpo_number[a] < rpo_number[b]; });
+
+			block_id outside = no_block;
+			uint32_t entries = 0;
+
+			for (const auto predecessor : fn.blocks[header].predecessors)
+				if (visited[predecessor] != number)
+				{
+					outside = predecessor;
+					entries++;
+				}
+
+			if (entries == 1 && fn.blocks[outside].successors.size() == 1)
+				loop.preheader = outside;
+
+			loops.push_back(std::move(loop));
+		}
+
+		return loops;
+	}
+
+	// 除数不是非零常量的除法与取模可能出错
+	bool may_trap(const function& fn, const instruction& inst)
+	{
+		if (inst.code != opcode::binary || (inst.op != operand_type::div && inst.op != operand_type::mod))
+			return false;
+
+		const auto& divisor = fn.values[inst.b];
+		const uint32_t magnitude = divisor.type == number_type::float_point ? divisor.a & 0x7fffffffu : divisor.a; // 浮点数忽略符号位
+
+		return divisor.code != opcode::constant || magnitude == 0;
+	}
+
+	std::optional<simple_loop> match_simple_loop(const function& fn, const natural_loop& loop)
+	{
+		if (loop.blocks.size() != 2) return std::nullopt;
+
+		simple_loop result;
+		result.header = loop.header;
+		result.body = loop.blocks[1];
+
+		const auto& header = fn.blocks[result.header];
+		const auto& body = fn.blocks[result.body];
+
+		if (header.predecessors.size() != 2 || body.predecessors.size() != 1 || !body.phis.empty()) return std::nullopt;
+		if (body.successors.size() != 1 || body.successors[0] != result.header) return std::nullopt;
+
+		const auto terminator = header.terminator(fn.values);
+		if (terminator == no_value) return std::nullopt;
+
+		const auto& branch = fn.values[terminator];
+		if (branch.code != opcode::branch || branch.b != result.body || branch.c == result.body || branch.c == result.header) return std::nullopt;
+
+		result.exit = branch.c;
+		result.latch = header.predecessors[0] == result.body ? 0 : 1;
+		result.entry = 1 - result.latch;
+
+		if (header.predecessors[result.entry] == result.body) return std::nullopt;
+		return result;
+	}
+
+	// 以常量折叠逐轮模拟决定条件的指令，求循环体的执行次数
+	// 条件依赖常量与头部 φ 以外的值、求值出错或超过 limit 轮时返回空
+	std::optional<uint32_t> trip_count(const function& fn, const simple_loop& loop, uint32_t limit)
+	{
+		using constant_folding::constant;
+
+		const auto condition = fn.values[fn.blocks[loop.header].terminator(fn.values)].a;
+
+		std::unordered_map<value_id, constant> known;
+		std::unordered_set<value_id> slice;
+		std::vector<value_id> stack{ condition };
+
+		while (!stack.empty())
+		{
+			const auto id = stack.back();
+			stack.pop_back();
+
+			const auto& inst = fn.values[id];
+
+			// 循环外的值只能是常量
+			if (inst.block != loop.header && inst.block != loop.body)
+			{
+				if (inst.code != opcode::constant) return std::nullopt;
+
+				known[id] = { inst.type, { .uint_number = inst.a } };
+				continue;
+			}
+
+			if (!slice.insert(id).second) continue;
+
+			switch (inst.code)
+			{
+			case opcode::constant:
+			case opcode::binary:
+			case opcode::unary:
+			case opcode::convert:
+			case opcode::phi:
+				fn.for_each_operand(id, [&](value_id use) { stack.push_back(use); });
+				break;
+
+			default:
+				return std::nullopt;
+			}
+		}
+
+		// 按执行顺序排列
+		std::vector<value_id> phis, header_code, body_code;
+
+		for (const auto id : fn.blocks[loop.header].phis)
+			if (slice.contains(id)) phis.push_back(id);
+
+		for (const auto id : fn.blocks[loop.header].code)
+			if (slice.contains(id)) header_code.push_back(id);
+
+		for (const auto id : fn.blocks[loop.body].code)
+			if (slice.contains(id)) body_code.push_back(id);
+
+		auto evaluate = [&](const std::vector<value_id>& code)
+		{
+			for (const auto id : code)
+			{
+				const auto& inst = fn.values[id];
+				std::optional<constant> value;
+
+				switch (inst.code)
+				{
+				case opcode::constant:
+					value = constant{ inst.type, { .uint_number = inst.a } };
+					break;
+
+				case opcode::binary:
+					value = constant_folding::fold_binary(inst.op, known[inst.a], known[inst.b]);
+					break;
+
+				case opcode::unary:
+					value = constant_folding::fold_prefix(inst.op, known[inst.a]);
+					break;
+
+				case opcode::convert:
+					value = constant_folding::convert(known[inst.a], inst.type);
+					break;
+
+				default:
+					break;
+				}
+
+				if (!value) return false;
+				known[id] = *value;
+			}
+
+			return true;
+		};
+
+		for (const auto phi : phis)
+			known[phi] = known[fn.operands_of(phi)[loop.entry]];
+
+		std::vector<constant> next(phis.size());
+
+		for (uint32_t trips = 0; trips <= limit; trips++)
+		{
+			if (!evaluate(header_code)) return std::nullopt;
+			if (known[condition].value.uint_number == 0) return trips;
+
+			if (!evaluate(body_code)) return std::nullopt;
+
+			for (size_t i = 0; i < phis.size(); i++)
+				next[i] = known[fn.operands_of(phis[i])[loop.latch]];
+
+			for (size_t i = 0; i < phis.size(); i++)
+				known[phis[i]] = next[i];
+		}
+
+		return std::nullopt;
+	}
+
+	struct unroller
+	{
+		function& fn;
+		std::vector<value_id> forward; // 完全展开后被删除的头部值 -> 最后一轮的副本
+		std::unordered_map<value_id, value_id> mapping; // 本轮中循环内的值 -> 副本
+		std::vector<value_id> code, next;
+
+		unroller(function& fn) : fn(fn) {}
+
+		value_id find(value_id value) const
+		{
+			while (value < forward.size() && forward[value] != value) value = forward[value];
+			return value;
+		}
+
+		value_id lookup(value_id value) const
+		{
+			const auto found = mapping.find(value);
+			return found != mapping.end() ? found->second : value;
+		}
+
+		// 将指令复制到 block 末尾的 code 中，操作数替换为本轮的副本
+		void clone(std::span<const value_id> source, block_id block)
+		{
+			for (const auto id : source)
+			{
+				const auto copy = fn.add(block, fn.values[id]);
+				if (fn.values[copy].code == opcode::call) fn.set_operands(copy, fn.operands_of(id));
+
+				fn.for_each_operand(copy, [&](value_id& use) { use = lookup(use); });
+
+				mapping[id] = copy;
+				code.push_back(copy);
+			}
+		}
+
+		// 进入下一轮：头部 φ 取上一轮回边流入的值
+		void advance(const simple_loop& loop)
+		{
+			const auto& phis = fn.blocks[loop.header].phis;
+			next.resize(phis.size());
+
+			for (size_t i = 0; i < phis.size(); i++)
+				next[i] = lookup(fn.operands_of(phis[i])[loop.latch]);
+
+			for (size_t i = 0; i < phis.size(); i++)
+				mapping[phis[i]] = next[i];
+		}
+
+		// 完全展开：头部改为依次执行各轮的条件与循环体、最后一次条件，再跳转到出口；循环体随之删除
+		void unroll_fully(const simple_loop& loop, uint32_t trips)
+		{
+			if (forward.empty())
+			{
+				forward.resize(fn.values.size());
+				for (value_id i = 0; i < forward.size(); i++) forward[i] = i;
+			}
+
+			auto& header = fn.blocks[loop.header];
+			auto& body = fn.blocks[loop.body];
+
+			const auto header_code = std::span<const value_id>(header.code).first(header.code.size() - 1);
+			const auto body_code = std::span<const value_id>(body.code).first(body.code.size() - 1);
+
+			mapping.clear();
+			code.clear();
+
+			for (const auto phi : header.phis)
+				mapping[phi] = fn.operands_of(phi)[loop.entry];
+
+			for (uint32_t i = 0; i < trips; i++)
+			{
+				clone(header_code, loop.header);
+				clone(body_code, loop.header);
+				advance(loop);
+			}
+
+			clone(header_code, loop.header);
+
+			// 循环外对头部的值的使用改为最后一轮的副本
+			for (const auto phi : header.phis)
+			{
+				forward[phi] = lookup(phi);
+				fn.values[phi].code = opcode::nop;
+			}
+
+			for (const auto id : header_code)
+			{
+				forward[id] = lookup(id);
+				fn.values[id].code = opcode::nop;
+			}
+
+			for (const auto id : body.code) fn.values[id].code = opcode::nop;
+
+			auto& terminator = fn.values[header.code.back()];
+			terminator.code = opcode::jump;
+			terminator.a = loop.exit;
+			terminator.b = terminator.c = 0;
+
+			code.push_back(header.code.back());
+			header.code = code;
+			header.phis.clear();
+
+			header.predecessors = { header.predecessors[loop.entry] };
+			header.successors = { loop.exit };
+
+			body.code.clear();
+			body.predecessors.clear();
+			body.successors.clear();
+		}
+
+		// 部分展开 factor 倍：循环体末尾追加 factor - 1 份头部与循环体的副本，其间的条件因次数整除而必然成立
+		void unroll_partially(const simple_loop& loop, uint32_t factor)
+		{
+			auto& header = fn.blocks[loop.header];
+			auto& body = fn.blocks[loop.body];
+
+			const auto header_code = std::span<const value_id>(header.code).first(header.code.size() - 1);
+
+			mapping.clear();
+			code.assign(body.code.begin(), body.code.end() - 1);
+
+			const auto body_code = std::vector<value_id>(code);
+
+			for (uint32_t i = 1; i < factor; i++)
+			{
+				advance(loop);
+				clone(header_code, loop.body);
+				clone(body_code, loop.body);
+			}
+
+			for (const auto phi : header.phis)
+			{
+				auto& incoming = fn.operands_of(phi)[loop.latch];
+				incoming = lookup(incoming);
+			}
+
+			code.push_back(body.code.back());
+			body.code = code;
+		}
+	};
+}
+
+bool compiler::ir::hoist_invariants(function& fn, analysis_manager& analyses)
+{
+	const auto& dominators = analyses.dominators();
+	const auto loops = find_loops(fn, dominators, rpo_numbers(fn, dominators));
+
+	std::vector<uint32_t> member(fn.blocks.size(), UINT32_MAX); // 块所属的、正在处理的循环
+	std::vector<variable_index> stored_globals;
+	std::vector<value_id> hoisted;
+	bool changed = false;
+
+	for (uint32_t i = 0; i < loops.size(); i++)
+	{
+		const auto& loop = loops[i];
+		if (loop.preheader == no_block) continue;
+
+		for (const auto block : loop.blocks) member[block] = i;
+
+		// 循环中的写入与调用
+		bool writes_memory = false, calls = false;
+		stored_globals.clear();
+
+		for (const auto block : loop.blocks)
+			for (const auto id : fn.blocks[block].code)
+			{
+				const auto& inst = fn.values[id];
+
+				if (inst.code == opcode::store) writes_memory = true;
+				else if (inst.code == opcode::store_global) stored_globals.push_back(inst.a);
+				else if (inst.code == opcode::call) calls = true;
+			}
+
+		auto invariant = [&](value_id id, block_id block)
+		{
+			bool outside = true;
+			fn.for_each_operand(id, [&](value_id use) { outside = outside && member[fn.values[use].block] != i; });
+
+			if (!outside) return false;
+
+			const auto& inst = fn.values[id];
+
+			switch (inst.code)
+			{
+			case opcode::constant:
+			case opcode::unary:
+			case opcode::convert:
+				return true;
+
+			case opcode::binary:
+				return !may_trap(fn, inst);
+
+			case opcode::load: // 全局变量可能位于 @ 可访问的内存中
+				return block == loop.header && !writes_memory && stored_globals.empty() && !calls;
+
+			case opcode::load_global: // @ 写入可能落在全局变量上
+				return block == loop.header && !writes_memory && !calls && std::find(stored_globals.begin(), stored_globals.end(), inst.a) == stored_globals.end();
+
+			default:
+				return false;
+			}
+		};
+
+		// 按逆后序处理，外提的指令随即视为循环外的值，使用它的指令可继续外提
+		hoisted.clear();
+
+		for (const auto block : loop.blocks)
+			std::erase_if(fn.blocks[block].code, [&](value_id id)
+			{
+				if (!invariant(id, block)) return false;
+
+				fn.values[id].block = loop.preheader;
+				hoisted.push_back(id);
+				return true;
+			});
+
+		if (hoisted.empty()) continue;
+
+		auto& code = fn.blocks[loop.preheader].code;
+		code.insert(code.end() - 1, hoisted.begin(), hoisted.end());
+		changed = true;
+	}
+
+	return changed;
+}
+
+bool compiler::ir::unroll_loops(function& fn, analysis_manager& analyses)
+{
+	if (unroll_budget == 0) return false;
+
+	const auto& dominators = analyses.dominators();
+	const auto loops = find_loops(fn, dominators, rpo_numbers(fn, dominators));
+
+	unroller state(fn);
+	std::vector<bool> removed(fn.blocks.size());
+	bool changed = false, compact = false;
+
+	for (const auto& loop : loops)
+	{
+		const auto simple = match_simple_loop(fn, loop);
+		if (!simple) continue;
+
+		const auto size = uint32_t(fn.blocks[simple->header].code.size() + fn.blocks[simple->body].code.size() - 2);
+		if (size == 0 || size > unroll_budget) continue;
+
+		const auto trips = trip_count(fn, *simple, max_simulated_trips);
+		if (!trips) continue;
+
+		if (uint64_t(*trips) * size <= unroll_budget)
+		{
+			state.unroll_fully(*simple, *trips);
+			removed[simple->body] = true;
+			changed = compact = true;
+			continue;
+		}
+
+		// 能整除次数的最大倍数
+		for (uint32_t factor = std::min(*trips, unroll_budget / size); factor >= 2; factor--)
+			if (*trips % factor == 0)
+			{
+				state.unroll_partially(*simple, factor);
+				changed = true;
+				break;
+			}
+	}
+
+	if (!state.forward.empty())
+		for (value_id i = 0; i < fn.values.size(); i++)
+			if (fn.values[i].code != opcode::nop)
+				fn.for_each_operand(i, [&](value_id& use) { use = state.find(use); });
+
+	if (compact)
+		compact_blocks(fn, removed);
+
+	return changed;
+}
@@ -0,0 +1,25 @@
+// compiler-loops.h: 循环不变量外提与循环展开
+
+#pragma once
+
+#include "compiler-head.h"
+#include "compiler-ir.h"
+#include "compiler-pass-manager.h"
+
+namespace compiler::ir
+{
+	// 循环展开的代码量预算：展开后循环的指令数上限，为 0 时不展开；驱动程序以 --unroll-budget=N 设置
+	inline uint32_t unroll_budget = 64;
+
+	// 循环不变量外提：自内层循环起，将操作数均在循环外定义的常量、算术与地址计算移到循环的前置块
+	// 可能因除以零出错的运算不外提；读取内存与全局变量只在位于循环头部、且循环中没有调用与对应写入时外提（@ 写入与全局变量写入相互视为对方的写入）
+	// 只处理头部有唯一的循环外前驱、且该前驱只流向头部的循环；不改变控制流
+	bool hoist_invariants(function& fn, analysis_manager& analyses);
+
+	// 循环展开：循环体为单个块、条件只依赖常量与头部 φ 时，以常量折叠逐轮模拟求出执行次数
+	// 次数与每轮指令数之积不超过 unroll_budget 时完全展开为直线代码，否则在预算内按能整除次数的最大倍数部分展开
+	bool unroll_loops(function& fn, analysis_manager& analyses);
+
+	constexpr pass hoist_invariants_pass{ "licm", &hoist_invariants, preserves(analysis_dominators) };
+	constexpr pass unroll_loops_pass{ "unroll", &unroll_loops, preserve_none };
+}
@@ -1,169 +1,375 @@
-// compiler-numeric-parser.cpp: ݹ½ѧʽ
+// compiler-numeric-parser.cpp: ȼѧʽ
 
 #include "compiler-syntax-parser.h"
 
 using namespace compiler;
 
-node_value* compiler::numeric_parser::parse_numeric_expression(const token_list& list, size_t& index, size_t depth)
+void compiler::numeric_parser::expression_dag::reset()
 {
-	try
+	count = 0;
+
+	// λʱղλϾɽڵ
+	if (++generation == 0)
 	{
-		auto node = parse_priority9(list, index, depth);
+		std::fill(slots.begin(), slots.end(), slot());
+		generation = 1;
+	}
+}
+
+node_index compiler::numeric_parser::expression_dag::intern(syntax_tree& tree, const node_value& node)
+{
+	// ȡַ뺯òϲ
+	if (node.node_type == node_value::node_function || (node.node_type == node_value::node_operator && node.op_type == operand_type::get_address))
+		return tree.add_node(node);
 
-		if (index >= list.size())
-			return node;
+	// ʶڵ right ¼λãȽϣʱ״γֵλ
+	auto right_of = [](const node_value& node)
+	{
+		return node.node_type == node_value::node_identifier ? invalid_node : node.right;
+	};
 
-		if (list.at(index).match(token_type::right_parentheses) && depth != 0)
-			index++;
+	auto hash = [&](const node_value& node)
+	{
+		uint64_t h = (uint64_t(node.node_type) << 8 | uint64_t(node.op_type)) ^ (uint64_t(node.value.uint_number) << 16);
+		h = (h ^ (uint64_t(node.left) << 32 | right_of(node))) * 0x9E3779B97F4A7C15ull;
+		return size_t(h ^ (h >> 29));
+	};
 
-		return node;
+	auto same = [&](const node_value& a, const node_value& b)
+	{
+		return a.node_type == b.node_type && a.op_type == b.op_type && a.value.uint_number == b.value.uint_number && a.left == b.left && right_of(a) == right_of(b);
+	};
+
+	// سһʱݣֻǨƱĲλ
+	if ((count + 1) * 2 > slots.size())
+	{
+		std::vector<slot> old(std::max<size_t>(64, slots.size() * 2));
+		old.swap(slots);
+
+		const size_t mask = slots.size() - 1;
+		for (const auto& entry : old)
+			if (entry.generation == generation)
+			{
+				size_t i = hash(tree[entry.node]) & mask;
+				while (slots[i].generation == generation) i = (i + 1) & mask;
+				slots[i] = entry;
+			}
 	}
-	catch (std::exception)
+
+	const size_t mask = slots.size() - 1;
+
+	for (size_t i = hash(node) & mask;; i = (i + 1) & mask)
 	{
-		throw syntax_parsing_exception(-1, -1, "Unable to parse the expression.");
+		auto& entry = slots[i];
+
+		if (entry.generation != generation)
+		{
+			entry = { tree.add_node(node), generation };
+			count++;
+			return entry.node;
+		}
+
+		if (same(tree[entry.node], node))
+			return entry.node;
 	}
 }
 
-node_value* compiler::numeric_parser::parse_priority0(const token_list& list, size_t& index, size_t depth)
+template<class list_type>
+parse_result<node_index> compiler::numeric_parser::parse_numeric_expression(const list_type& list, size_t& index, parse_context& context)
 {
-	return parse_single_operand<operand_type::get_address>(list, index, parse_number, depth);
-}
+	auto& tree = context.tree;
+	auto& [operands, operators, frames, arguments] = context.expression;
 
-node_value* compiler::numeric_parser::parse_priority1(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_single_operand<operand_type::bit_not>(list, index, parse_priority0, depth);
-}
+	operands.clear();
+	operators.clear();
+	frames.clear();
+	arguments.clear();
 
-node_value* compiler::numeric_parser::parse_priority2(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_double_operand<operand_type::mul, operand_type::div, operand_type::mod>(list, index, parse_priority1, depth);
-}
+	frames.push_back({ expression_frame::root, 0, 0, 0 });
 
-node_value* compiler::numeric_parser::parse_priority3(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_double_operand<operand_type::add, operand_type::sub>(list, index, parse_priority2, depth);
-}
+	uint8_t max_level = UINT8_MAX; // һǰ׺Ĳ㼶ڴֵ
 
-node_value* compiler::numeric_parser::parse_priority4(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_double_operand<operand_type::bit_lsh, operand_type::bit_rsh>(list, index, parse_priority3, depth);
-}
+	auto fail = [&](const char* msg)
+	{
+		context.report(list, index, msg);
+		return parse_result<node_index>::error();
+	};
 
-node_value* compiler::numeric_parser::parse_priority5(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_double_operand<operand_type::smaller, operand_type::smaller_or_equal, operand_type::larger, operand_type::larger_or_equal>(list, index, parse_priority4, depth);
-}
+	// ڵ㣺ʱͬĴڵֻһ
+	auto add_node = [&](const node_value& node)
+	{
+		return context.share_subexpressions ? context.dag.intern(tree, node) : tree.add_node(node);
+	};
 
-node_value* compiler::numeric_parser::parse_priority6(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_double_operand<operand_type::equal, operand_type::not_equal>(list, index, parse_priority5, depth);
-}
+	auto constant_of = [&](node_index index)
+	{
+		return constant_folding::constant{ tree[index].number_type, tree[index].value };
+	};
 
-node_value* compiler::numeric_parser::parse_priority7(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_double_operand<operand_type::bit_and>(list, index, parse_priority6, depth);
-}
+	// ۵滻
+	// ۵ĳǡΪڵĩβĽڵʱڵʱˣ͵ظǣΪһڵ㣻ڵ
+	auto replace_constant = [&](node_index operand, bool at_end, const constant_folding::constant& value)
+	{
+		if (at_end && !context.share_subexpressions)
+		{
+			tree.nodes.resize(size_t(operand) + 1);
 
-node_value* compiler::numeric_parser::parse_priority8(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_double_operand<operand_type::bit_xor, operand_type::not_equal>(list, index, parse_priority7, depth);
-}
+			auto& node = tree[operand];
+			node.number_type = value.type;
+			node.value = value.value;
+			return operand;
+		}
 
-node_value* compiler::numeric_parser::parse_priority9(const token_list& list, size_t& index, size_t depth)
-{
-	return parse_double_operand<operand_type::bit_or, operand_type::not_equal>(list, index, parse_priority8, depth);
-}
+		node_value node;
+		node.node_type = node_value::node_constant;
+		node.number_type = value.type;
+		node.value = value.value;
+		return add_node(node);
+	};
 
-node_value* compiler::numeric_parser::parse_number(const token_list& list, size_t& index, size_t depth)
-{
-	auto& tgt = list.at(index);
+	// Լջ power ĶԪ㣬֤ͬ
+	auto reduce = [&](uint8_t power)
+	{
+		const size_t base = frames.back().operator_base;
+
+		while (operators.size() > base && operators.back().binary >= power)
+		{
+			const node_index left = operands[operands.size() - 2], right = operands.back();
+
+			// Ϊ
+			if (context.fold_constants && tree[left].node_type == node_value::node_constant && tree[right].node_type == node_value::node_constant)
+				if (auto value = constant_folding::fold_binary(operators.back().op_type, constant_of(left), constant_of(right)))
+				{
+					operands.pop_back();
+					operands.back() = replace_constant(left, left + 1 == right && right + 1 == tree.nodes.size(), *value);
+					operators.pop_back();
+					continue;
+				}
 
-	switch (tgt.type)
+			node_value node;
+			node.node_type = node_value::node_operator;
+			node.op_type = operators.back().op_type;
+			node.right = operands.back();
+			operands.pop_back();
+			node.left = operands.back();
+
+			operands.back() = add_node(node);
+			operators.pop_back();
+		}
+	};
+
+	// ϣñδõǰ׺
+	auto push_operand = [&](node_index operand)
 	{
-	case token_type::left_parentheses: // 
-		return parse_numeric_expression(list, ++index, depth + 1);
+		const size_t base = frames.back().operator_base;
 
-	case token_type::double_operand:
-		if (tgt.op_type == operand_type::sub) // 
+		while (operators.size() > base && operators.back().binary == 0)
 		{
-			auto ret = new node_value();
-			ret->node_type = node_value::node_constant;
+			if (context.fold_constants && tree[operand].node_type == node_value::node_constant)
+				if (auto value = constant_folding::fold_prefix(operators.back().op_type, constant_of(operand)))
+				{
+					operand = replace_constant(operand, operand + 1 == tree.nodes.size(), *value);
+					operators.pop_back();
+					continue;
+				}
 
-			auto& val_token = list.at(++index);
+			node_value node;
+			node.node_type = node_value::node_operator;
+			node.op_type = operators.back().op_type;
+			node.left = operand;
 
-			if (val_token.type == token_type::number) // 
+			operand = add_node(node);
+			operators.pop_back();
+		}
+
+		operands.push_back(operand);
+	};
+
+	while (true)
+	{
+		// ڴ
+		if (!has_token(list, index))
+			return fail("Unexpected end of expression.");
+
+		const auto& tgt = list.at(index);
+
+		// ǰ׺
+		if (tgt.type == token_type::single_operand)
+		{
+			const uint8_t level = precedence_table[size_t(tgt.op_type)].prefix;
+
+			if (level != 0 && level < max_level)
 			{
-				ret->value = val_token.get_negative_val(); // ȡ
-				ret->number_type = val_token.number_type;
+				operators.push_back({ tgt.op_type, 0 });
+				max_level = level;
+				index++;
+				continue;
 			}
+		}
+
+		switch (tgt.type)
+		{
+		case token_type::left_parentheses: // 
+			if (frames.size() > context.max_expression_depth)
+				return fail("Expression nested too deeply.");
 
+			frames.push_back({ expression_frame::parentheses, uint32_t(operators.size()), 0, 0 });
+			max_level = UINT8_MAX;
 			index++;
-			return ret;
-		}
-		else // ţͳһΪЧ
-			throw syntax_parsing_exception(tgt.line, tgt.character, "Invalid expression.");
+			continue;
 
-	case token_type::number: // 
-	{
-		auto ret = new node_value();
+		case token_type::double_operand:
+			if (tgt.op_type == operand_type::sub) // 
+			{
+				if (!token_is(list, ++index, token_type::number)) // ֳֻ
+					return fail("Invalid expression.");
 
-		ret->node_type = node_value::node_constant;
-		ret->value = tgt.number_data;
-		ret->number_type = tgt.number_type;
+				const auto& val_token = list.at(index);
 
-		index++;
-		return ret;
-	}
+				if (val_token.number_type == number_type::unsigned_integer)
+					return fail("Can't apply negative operand to an unsigned integer.");
 
-	case token_type::identifier: // ʶ
-		if (index < list.size() - 1)
-			if (list.at(index + 1).type == token_type::left_parentheses)
-			{
-				// 
-				auto ret = new node_value();
-				ret->node_type = node_value::node_function;
-				ret->identifier = tgt.literal;
+				node_value ret;
+				ret.node_type = node_value::node_constant;
+				ret.value = val_token.get_negative_val(); // ȡ
+				ret.number_type = val_token.number_type;
+
+				index++;
+				push_operand(add_node(ret));
+				break;
+			}
+			else // ţͳһΪЧ
+				return fail("Invalid expression.");
+
+		case token_type::number: // 
+		{
+			node_value ret;
+			ret.node_type = node_value::node_constant;
+			ret.value = tgt.number_data;
+			ret.number_type = tgt.number_type;
+
+			index++;
+			push_operand(add_node(ret));
+			break;
+		}
 
+		case token_type::identifier: // ʶ
+			if (token_is(list, index + 1, token_type::left_parentheses))
+			{
+				// ںڵ㴴д parameters
+				const symbol_id function = tgt.symbol;
 				index += 2;
 
-				if (list.at(index).type == token_type::right_parentheses)
+				if (token_is(list, index, token_type::right_parentheses))
 				{
+					node_value ret;
+					ret.node_type = node_value::node_function;
+					ret.identifier = function;
+					ret.left = node_index(tree.parameters.size());
+					ret.right = 0;
+
 					index++;
-					return ret;
+					push_operand(tree.add_node(ret));
+					break;
 				}
 
-				while (1)
+				if (frames.size() > context.max_expression_depth)
+					return fail("Expression nested too deeply.");
+
+				frames.push_back({ expression_frame::call, uint32_t(operators.size()), uint32_t(arguments.size()), function });
+				max_level = UINT8_MAX;
+				continue;
+			}
+			else
+			{
+				// ͨʶ
+				node_value ret;
+				ret.node_type = node_value::node_identifier;
+				ret.identifier = tgt.symbol;
+				ret.right = node_index(tree.identifier_positions.size());
+				tree.identifier_positions.push_back(position_of(list, index));
+
+				index++;
+				push_operand(add_node(ret));
+				break;
+			}
+
+		default:
+			return fail("Invalid token here.");
+		}
+
+		// ֮󣺶Ԫ㣬Ԫ
+		while (true)
+		{
+			if (has_token(list, index))
+			{
+				const auto& operand = list.at(index);
+				const uint8_t power = operand.type == token_type::double_operand ? precedence_table[size_t(operand.op_type)].binary : 0;
+
+				if (power != 0)
 				{
-					ret->parameter_list.push_back(parse_numeric_expression(list, index));
-
-					if (index >= list.size())
-						throw syntax_parsing_exception(-1, -1, "Invalid function call format.");
-
-					if (list.at(index).type == token_type::separator)
-					{
-						index++;
-						continue;
-					}
-					else if (list.at(index).type == token_type::right_parentheses)
-					{
-						index++;
-						return ret;
-					}
-					else
-						throw syntax_parsing_exception(-1, -1, "Invalid function call format.");
+					reduce(power);
+					operators.push_back({ operand.op_type, power });
+					index++;
+					break;
 				}
 			}
-		{
-			// ͨʶ
-			auto ret = new node_value();
-			ret->node_type = node_value::node_identifier;
-			ret->identifier = tgt.literal;
+
+			reduce(1);
+			const auto frame = frames.back();
+
+			if (frame.type == expression_frame::root)
+			{
+				frames.pop_back();
+				return parse_result<node_index>::of(operands.back());
+			}
+
+			if (frame.type == expression_frame::parentheses)
+			{
+				// ſʡ
+				if (token_is(list, index, token_type::right_parentheses))
+					index++;
+
+				frames.pop_back();
+
+				const auto inner = operands.back();
+				operands.pop_back();
+				push_operand(inner);
+				continue;
+			}
+
+			// 
+			arguments.push_back(operands.back());
+			operands.pop_back();
+
+			if (token_is(list, index, token_type::separator))
+			{
+				index++;
+				break;
+			}
+
+			if (!token_is(list, index, token_type::right_parentheses))
+				return fail("Invalid function call format.");
+
+			node_value ret;
+			ret.node_type = node_value::node_function;
+			ret.identifier = frame.function;
+			ret.left = node_index(tree.parameters.size());
+			ret.right = node_index(arguments.size() - frame.argument_base);
+
+			tree.parameters.insert(tree.parameters.end(), arguments.begin() + frame.argument_base, arguments.end());
+			arguments.resize(frame.argument_base);
+			frames.pop_back();
 
 			index++;
-			return ret;
+			push_operand(tree.add_node(ret));
 		}
 
-	default:
-		throw syntax_parsing_exception(tgt.line, tgt.character, "Invalid token here.");
+		max_level = UINT8_MAX;
 	}
-}
\ No newline at end of file
+}
+
+// ʽʵ
+template parse_result<node_index> compiler::numeric_parser::parse_numeric_expression(const token_list& list, size_t& index, parse_context& context);
+template parse_result<node_index> compiler::numeric_parser::parse_numeric_expression(const token_stream& list, size_t& index, parse_context& context);
+template parse_result<node_index> compiler::numeric_parser::parse_numeric_expression(const token_reader& list, size_t& index, parse_context& context);
\ No newline at end of file
@@ -0,0 +1,110 @@
+// compiler-pass-manager.cpp: 按函数调度优化 pass，缓存分析结果并按 pass 声明的保留集失效
+
+#include "compiler-pass-manager.h"
+
+using namespace compiler;
+using namespace compiler::ir;
+
+namespace
+{
+	using clock_type = std::chrono::steady_clock;
+
+	double elapsed_milliseconds(clock_type::time_point since)
+	{
+		return std::chrono::duration<double, std::milli>(clock_type::now() - since).count();
+	}
+
+	// 缓存中没有时计算分析并计时
+	template<class result_type, class builder_type>
+	const result_type& cached(std::optional<result_type>& cache, analysis_statistics& statistics, builder_type&& build)
+	{
+		if (!cache)
+		{
+			const auto start = clock_type::now();
+			cache.emplace(build());
+
+			statistics.computed++;
+			statistics.milliseconds += elapsed_milliseconds(start);
+		}
+
+		return *cache;
+	}
+
+	const char* analysis_names[] = { "dominators", "uses", "liveness" };
+}
+
+const dominator_tree& compiler::ir::analysis_manager::dominators()
+{
+	return cached(dominator_cache, statistics[analysis_dominators], [&] { return build_dominators(fn); });
+}
+
+const use_list& compiler::ir::analysis_manager::uses()
+{
+	return cached(use_cache, statistics[analysis_uses], [&] { return build_uses(fn); });
+}
+
+const liveness& compiler::ir::analysis_manager::live_values()
+{
+	return cached(liveness_cache, statistics[analysis_liveness], [&] { return build_liveness(fn); });
+}
+
+void compiler::ir::analysis_manager::invalidate(analysis_set preserved)
+{
+	if (!(preserved & preserves(analysis_dominators))) dominator_cache.reset();
+	if (!(preserved & preserves(analysis_uses))) use_cache.reset();
+	if (!(preserved & preserves(analysis_liveness))) liveness_cache.reset();
+}
+
+void compiler::ir::pass_manager::add(const pass& p)
+{
+	passes.push_back(p);
+	pass_stats.emplace_back();
+}
+
+void compiler::ir::pass_manager::run(function& fn)
+{
+	analysis_manager analyses(fn, analysis_stats.data());
+
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		const auto start = clock_type::now();
+		const bool changed = passes[i].run(fn, analyses);
+
+		auto& statistics = pass_stats[i];
+		statistics.runs++;
+		statistics.milliseconds += elapsed_milliseconds(start);
+
+		if (changed)
+		{
+			statistics.changed++;
+			analyses.invalidate(passes[i].preserved);
+		}
+	}
+}
+
+void compiler::ir::pass_manager::run(module& program)
+{
+	for (auto& fn : program.functions)
+		run(fn);
+}
+
+void compiler::ir::pass_manager::report(std::ostream& out) const
+{
+	double total = 0;
+
+	out << std::format("{:<24}{:>8}{:>10}{:>12}", "pass", "runs", "changed", "time (ms)") << std::endl;
+
+	for (size_t i = 0; i < passes.size(); i++)
+	{
+		const auto& statistics = pass_stats[i];
+		total += statistics.milliseconds;
+
+		out << std::format("{:<24}{:>8}{:>10}{:>12.3f}", passes[i].name, statistics.runs, statistics.changed, statistics.milliseconds) << std::endl;
+	}
+
+	// 分析的耗时已计入请求它的 pass
+	for (size_t i = 0; i < analysis_kind_count; i++)
+		out << std::format("{:<24}{:>8}{:>10}{:>12.3f}", std::format("  [{}]", analysis_names[i]), analysis_stats[i].computed, "", analysis_stats[i].milliseconds) << std::endl;
+
+	out << std::format("{:<24}{:>8}{:>10}{:>12.3f}", "total", "", "", total) << std::endl;
+}
@@ -0,0 +1,95 @@
+// compiler-pass-manager.h: 按函数调度优化 pass，缓存分析结果并按 pass 声明的保留集失效
+
+#pragma once
+
+#include "compiler-head.h"
+#include "compiler-ir.h"
+
+namespace compiler::ir
+{
+	// 分析种类，pass 以其位组合声明修改函数后仍然有效的分析
+	enum analysis_kind : uint8_t
+	{
+		analysis_dominators,
+		analysis_uses,
+		analysis_liveness,
+		analysis_kind_count
+	};
+
+	using analysis_set = uint32_t;
+
+	constexpr analysis_set preserve_none = 0;
+	constexpr analysis_set preserve_all = (1u << analysis_kind_count) - 1;
+
+	constexpr analysis_set preserves(analysis_kind kind)
+	{
+		return 1u << kind;
+	}
+
+	// 各分析的计算次数与耗时
+	struct analysis_statistics
+	{
+		uint32_t computed = 0;
+		double milliseconds = 0;
+	};
+
+	// 单个函数的分析缓存：首次请求时计算，失效前重复请求直接返回
+	// 返回的引用在下一次失效前有效
+	class analysis_manager
+	{
+		const function& fn;
+		analysis_statistics* statistics; // 按 analysis_kind 索引
+
+		std::optional<dominator_tree> dominator_cache;
+		std::optional<use_list> use_cache;
+		std::optional<liveness> liveness_cache;
+
+	public:
+		analysis_manager(const function& fn, analysis_statistics* statistics) : fn(fn), statistics(statistics) {}
+
+		const dominator_tree& dominators();
+		const use_list& uses();
+		const liveness& live_values();
+
+		// 函数已被修改：丢弃不在 preserved 中的分析
+		void invalidate(analysis_set preserved);
+	};
+
+	// 变换 pass：修改了函数时返回 true，此时不在 preserved 中的分析失效；未修改时全部分析保留
+	struct pass
+	{
+		const char* name = "";
+		bool (*run)(function& fn, analysis_manager& analyses) = nullptr;
+		analysis_set preserved = preserve_none;
+	};
+
+	// 各 pass 的运行次数、修改函数的次数与耗时
+	struct pass_statistics
+	{
+		uint32_t runs = 0;
+		uint32_t changed = 0;
+		double milliseconds = 0;
+	};
+
+	// pass 管理器：对每个函数依次运行全部 pass，函数之间不共享分析
+	class pass_manager
+	{
+		std::vector<pass> passes;
+		std::vector<pass_statistics> pass_stats; // 与 passes 对应
+		std::array<analysis_statistics, analysis_kind_count> analysis_stats;
+
+	public:
+		void add(const pass& p);
+
+		void run(function& fn);
+		void run(module& program);
+
+		// 输出各 pass 与各分析的耗时
+		void report(std::ostream& out) const;
+
+		inline size_t size() const
+		{
+			return passes.size();
+		}
+	};
+}
@@ -0,0 +1,379 @@
+// compiler-simplify.cpp: 代数化简与强度削减
+
+#include "compiler-simplify.h"
+#include "compiler-constant-folding.h"
+
+using namespace compiler;
+using namespace compiler::ir;
+
+namespace
+{
+	// 规则匹配的右操作数常量
+	enum class rule_constant : uint8_t
+	{
+		zero, // 整数 0、浮点数 +0；移位量只看低5位
+		one,
+		all_ones // 整数 -1，浮点数不匹配
+	};
+
+	// 规则的结果
+	enum class rule_result : uint8_t
+	{
+		left, // 左操作数
+		zero,
+		one,
+		all_ones
+	};
+
+	// 右操作数为常量时的恒等规则
+	struct constant_rule
+	{
+		operand_type op;
+		rule_constant right;
+		rule_result result;
+		bool float_safe; // 对浮点数也成立
+	};
+
+	constexpr constant_rule constant_rules[] =
+	{
+		{ operand_type::add, rule_constant::zero, rule_result::left, false }, // 浮点数 -0 + 0 为 +0
+		{ operand_type::sub, rule_constant::zero, rule_result::left, true },
+		{ operand_type::mul, rule_constant::one, rule_result::left, true },
+		{ operand_type::mul, rule_constant::zero, rule_result::zero, false }, // 浮点数 NaN * 0 为 NaN
+		{ operand_type::div, rule_constant::one, rule_result::left, true },
+		{ operand_type::mod, rule_constant::one, rule_result::zero, false },
+		{ operand_type::bit_and, rule_constant::zero, rule_result::zero, false },
+		{ operand_type::bit_and, rule_constant::all_ones, rule_result::left, false },
+		{ operand_type::bit_or, rule_constant::zero, rule_result::left, false },
+		{ operand_type::bit_or, rule_constant::all_ones, rule_result::all_ones, false },
+		{ operand_type::bit_xor, rule_constant::zero, rule_result::left, false },
+		{ operand_type::bit_lsh, rule_constant::zero, rule_result::left, false },
+		{ operand_type::bit_rsh, rule_constant::zero, rule_result::left, false },
+	};
+
+	// 两个操作数相同时的规则，只用于整数：浮点数的 NaN 与无穷使其不成立
+	struct same_operand_rule
+	{
+		operand_type op;
+		rule_result result;
+	};
+
+	constexpr same_operand_rule same_operand_rules[] =
+	{
+		{ operand_type::sub, rule_result::zero },
+		{ operand_type::bit_xor, rule_result::zero },
+		{ operand_type::bit_and, rule_result::left },
+		{ operand_type::bit_or, rule_result::left },
+		{ operand_type::equal, rule_result::one },
+		{ operand_type::not_equal, rule_result::zero },
+		{ operand_type::larger, rule_result::zero },
+		{ operand_type::smaller, rule_result::zero },
+		{ operand_type::larger_or_equal, rule_result::one },
+		{ operand_type::smaller_or_equal, rule_result::one },
+	};
+
+	// 可按结合律合并常量的整数运算
+	constexpr bool is_associative(operand_type op)
+	{
+		return op == operand_type::add || op == operand_type::mul || op == operand_type::bit_and || op == operand_type::bit_or || op == operand_type::bit_xor;
+	}
+
+	uint32_t float_bits(float value)
+	{
+		number_union data;
+		data.fp_number = value;
+		return data.uint_number;
+	}
+
+	bool is_power_of_two(uint32_t value)
+	{
+		return value != 0 && (value & (value - 1)) == 0;
+	}
+
+	uint32_t exponent_of(uint32_t value)
+	{
+		uint32_t result = 0;
+		while (value >>= 1) result++;
+		return result;
+	}
+
+	struct simplifier
+	{
+		function& fn;
+		std::vector<value_id> forward; // 被删除的值 -> 代替它的值
+		std::vector<value_id> rebuilt; // 正在重建的块的指令
+		block_id block = 0;
+		bool changed = false;
+
+		simplifier(function& fn) : fn(fn), forward(fn.values.size())
+		{
+			for (value_id i = 0; i < forward.size(); i++) forward[i] = i;
+		}
+
+		value_id find(value_id value)
+		{
+			while (forward[value] != value)
+			{
+				forward[value] = forward[forward[value]];
+				value = forward[value];
+			}
+
+			return value;
+		}
+
+		const instruction* constant_of(value_id value) const
+		{
+			const auto& inst = fn.values[value];
+			return inst.code == opcode::constant ? &inst : nullptr;
+		}
+
+		// 新建常量，放在当前指令之前；values 可能因此扩容，调用后须重新取指令的引用
+		value_id materialize(number_type type, uint32_t bits)
+		{
+			const auto id = fn.add(block, instruction{ opcode::constant, operand_type::none, type, no_block, bits });
+			forward.push_back(id);
+			rebuilt.push_back(id);
+			return id;
+		}
+
+		// 将指令就地改为常量
+		void make_constant(value_id id, uint32_t bits)
+		{
+			auto& inst = fn.values[id];
+			inst.code = opcode::constant;
+			inst.op = operand_type::none;
+			inst.a = bits;
+			inst.b = inst.c = 0;
+		}
+
+		// 以规则结果代替指令：取左操作数时记入替换表并删除指令，取常量时就地改为常量
+		void apply(value_id id, rule_result result)
+		{
+			auto& inst = fn.values[id];
+
+			switch (result)
+			{
+			case rule_result::left:
+				forward[id] = inst.a;
+				inst.code = opcode::nop;
+				break;
+
+			case rule_result::zero:
+				make_constant(id, 0);
+				break;
+
+			case rule_result::one:
+				make_constant(id, inst.type == number_type::float_point ? float_bits(1) : 1);
+				break;
+
+			case rule_result::all_ones:
+				make_constant(id, UINT32_MAX);
+				break;
+			}
+		}
+
+		static bool matches(const instruction& constant, number_type type, rule_constant kind, bool shift)
+		{
+			if (shift) return kind == rule_constant::zero && (constant.a & 31) == 0;
+
+			switch (kind)
+			{
+			case rule_constant::zero: return constant.a == 0;
+			case rule_constant::one: return constant.a == (type == number_type::float_point ? float_bits(1) : 1);
+			case rule_constant::all_ones: return type != number_type::float_point && constant.a == UINT32_MAX;
+			}
+
+			return false;
+		}
+
+		// 套用一条规则，有改写时返回 true
+		bool simplify_binary(value_id id)
+		{
+			const auto inst = fn.values[id]; // 副本：新建常量会使引用失效
+			const auto op = inst.op;
+			const auto left = constant_of(inst.a), right = constant_of(inst.b);
+
+			// 操作数均为常量
+			if (left && right)
+			{
+				const auto value = constant_folding::fold_binary(op, { left->type, { .uint_number = left->a } }, { right->type, { .uint_number = right->a } });
+				if (!value || value->type != inst.type) return false;
+
+				make_constant(id, value->value.uint_number);
+				return true;
+			}
+
+			// 可交换的运算将常量移到右侧
+			if (left && constant_folding::swapped(op) != operand_type::none)
+			{
+				auto& target = fn.values[id];
+				std::swap(target.a, target.b);
+				target.op = constant_folding::swapped(op);
+				return true;
+			}
+
+			const bool shift = constant_folding::is_shift(op);
+			const auto type = shift ? inst.type : fn.values[inst.a].type; // 比较的结果类型与操作数不同
+			const bool integer = type == number_type::integer || type == number_type::unsigned_integer;
+
+			if (inst.a == inst.b && integer)
+				for (const auto& rule : same_operand_rules)
+					if (rule.op == op)
+					{
+						apply(id, rule.result);
+						return true;
+					}
+
+			// 0 移位仍为 0
+			if (left && shift && integer && left->a == 0)
+			{
+				apply(id, rule_result::zero);
+				return true;
+			}
+
+			if (!right) return false;
+
+			for (const auto& rule : constant_rules)
+				if (rule.op == op && (integer || rule.float_safe) && matches(*right, type, rule.right, shift))
+				{
+					apply(id, rule.result);
+					return true;
+				}
+
+			if (!integer) return false;
+
+			const uint32_t c = right->a;
+
+			// 强度削减
+			auto rewrite = [&](operand_type new_op, number_type constant_type, uint32_t bits)
+			{
+				const auto constant = materialize(constant_type, bits);
+
+				auto& target = fn.values[id];
+				target.op = new_op;
+				target.b = constant;
+				return true;
+			};
+
+			if (op == operand_type::mul && is_power_of_two(c))
+				return rewrite(operand_type::bit_lsh, number_type::integer, exponent_of(c));
+
+			if (type == number_type::unsigned_integer && op == operand_type::div && is_power_of_two(c))
+				return rewrite(operand_type::bit_rsh, number_type::integer, exponent_of(c));
+
+			if (type == number_type::unsigned_integer && op == operand_type::mod && is_power_of_two(c))
+				return rewrite(operand_type::bit_and, type, c - 1);
+
+			// 减常量化为加其相反数，以便与加法链合并
+			if (op == operand_type::sub)
+				return rewrite(operand_type::add, type, 0u - c);
+
+			// 合并常量运算链：(x op c1) op c2
+			const auto inner = fn.values[inst.a];
+			const auto inner_right = inner.code == opcode::binary && inner.op == op && inner.type == inst.type ? constant_of(inner.b) : nullptr;
+
+			if (!inner_right) return false;
+
+			if (is_associative(op) && inner_right->type == type)
+			{
+				const auto value = constant_folding::fold_binary(op, { type, { .uint_number = inner_right->a } }, { type, { .uint_number = c } });
+				if (!value) return false;
+
+				const auto constant = materialize(type, value->value.uint_number);
+
+				auto& target = fn.values[id];
+				target.a = inner.a;
+				target.b = constant;
+				return true;
+			}
+
+			if (shift)
+			{
+				const uint32_t total = (inner_right->a & 31) + (c & 31);
+
+				// 左移与无符号右移移出全部位时为 0，有符号右移最多移 31 位
+				if (total >= 32 && (op == operand_type::bit_lsh || type == number_type::unsigned_integer))
+				{
+					apply(id, rule_result::zero);
+					return true;
+				}
+
+				const auto constant = materialize(number_type::integer, std::min<uint32_t>(total, 31));
+
+				auto& target = fn.values[id];
+				target.a = inner.a;
+				target.b = constant;
+				return true;
+			}
+
+			return false;
+		}
+
+		// 套用一条规则，有改写时返回 true
+		bool simplify_step(value_id id)
+		{
+			const auto& inst = fn.values[id];
+
+			switch (inst.code)
+			{
+			case opcode::binary:
+				return simplify_binary(id);
+
+			case opcode::unary:
+				if (const auto operand = constant_of(inst.a))
+					if (const auto value = constant_folding::fold_prefix(inst.op, { operand->type, { .uint_number = operand->a } }))
+					{
+						make_constant(id, value->value.uint_number);
+						return true;
+					}
+				return false;
+
+			case opcode::convert:
+				if (const auto operand = constant_of(inst.a))
+				{
+					make_constant(id, constant_folding::convert({ operand->type, { .uint_number = operand->a } }, inst.type).value.uint_number);
+					return true;
+				}
+				return false;
+
+			default:
+				return false;
+			}
+		}
+	};
+}
+
+bool compiler::ir::simplify(function& fn, analysis_manager& analyses)
+{
+	simplifier state(fn);
+
+	// 按逆后序处理，操作数的定义先于使用被化简
+	for (const auto b : analyses.dominators().order)
+	{
+		state.block = b;
+		state.rebuilt.clear();
+
+		const auto code = std::move(fn.blocks[b].code);
+
+		for (const auto id : code)
+		{
+			fn.for_each_operand(id, [&](value_id& use) { use = state.find(use); });
+
+			while (fn.values[id].code != opcode::nop && state.simplify_step(id))
+				state.changed = true;
+
+			if (fn.values[id].code != opcode::nop)
+				state.rebuilt.push_back(id);
+		}
+
+		fn.blocks[b].code = state.rebuilt;
+	}
+
+	if (!state.changed) return false;
+
+	for (value_id i = 0; i < fn.values.size(); i++)
+		if (fn.values[i].code != opcode::nop)
+			fn.for_each_operand(i, [&](value_id& use) { use = state.find(use); });
+
+	return true;
+}
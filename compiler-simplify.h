@@ -0,0 +1,20 @@
+// compiler-simplify.h: 代数化简与强度削减
+
+#pragma once
+
+#include "compiler-head.h"
+#include "compiler-ir.h"
+#include "compiler-pass-manager.h"
+
+namespace compiler::ir
+{
+	// 代数化简：按支配树逆后序逐条改写 binary、unary 与 convert 指令，每条指令反复套用规则直到不再变化
+	// - 操作数均为常量时折叠，可交换的运算与比较将常量移到右侧
+	// - 恒等规则：x + 0、x * 1、x & -1、x ^ x 等化为操作数或常量
+	// - 强度削减：整数乘 2 的幂化为左移，无符号整数除以、模 2 的幂化为右移与按位与
+	// - 合并同向的常量移位与常量加、乘、位运算链
+	// 浮点数只使用 x - 0、x * 1、x / 1 这类对 NaN 与 -0 均成立的规则；不改变控制流
+	bool simplify(function& fn, analysis_manager& analyses);
+
+	constexpr pass simplify_pass{ "simplify", &simplify, preserves(analysis_dominators) };
+}
@@ -0,0 +1,99 @@
+// compiler-source-file.cpp: 源文件只读内存映射
+
+#include "compiler-source-file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace compiler;
+
+#ifdef _WIN32
+
+compiler::source_file::source_file(const std::string& path)
+{
+	file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE)
+	{
+		file_handle = nullptr;
+		throw compiler_exception(std::format("Unable to open source file \"{0}\".", path));
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size))
+	{
+		close();
+		throw compiler_exception(std::format("Unable to read the size of source file \"{0}\".", path));
+	}
+
+	length = size_t(file_size.QuadPart);
+	if (length == 0) return; // 空文件无法映射
+
+	mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_handle) data = (const char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		close();
+		throw compiler_exception(std::format("Unable to map source file \"{0}\".", path));
+	}
+}
+
+void compiler::source_file::close()
+{
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+
+	data = nullptr;
+	mapping_handle = file_handle = nullptr;
+	length = 0;
+}
+
+#else
+
+compiler::source_file::source_file(const std::string& path)
+{
+	file_descriptor = open(path.c_str(), O_RDONLY);
+	if (file_descriptor < 0)
+		throw compiler_exception(std::format("Unable to open source file \"{0}\".", path));
+
+	struct stat file_stat;
+	if (fstat(file_descriptor, &file_stat) != 0)
+	{
+		close();
+		throw compiler_exception(std::format("Unable to read the size of source file \"{0}\".", path));
+	}
+
+	length = size_t(file_stat.st_size);
+	if (length == 0) return; // 空文件无法映射
+
+	void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	if (mapped == MAP_FAILED)
+	{
+		close();
+		throw compiler_exception(std::format("Unable to map source file \"{0}\".", path));
+	}
+
+	madvise(mapped, length, MADV_SEQUENTIAL); // 词法分析自前向后单遍扫描
+	data = (const char*)mapped;
+}
+
+void compiler::source_file::close()
+{
+	if (data) munmap((void*)data, length);
+	if (file_descriptor >= 0) ::close(file_descriptor);
+
+	data = nullptr;
+	file_descriptor = -1;
+	length = 0;
+}
+
+#endif
@@ -0,0 +1,37 @@
+// compiler-source-file.h: 源文件只读内存映射
+
+#pragma once
+
+#include "compiler-base.h"
+
+namespace compiler
+{
+	// 只读映射的源文件，映射在对象生命周期内有效
+	// 由此得到的 string_view 可直接交给词法分析器，词元字面量引用映射内存，无需整体读入
+	class source_file
+	{
+	private:
+		const char* data = nullptr;
+		size_t length = 0;
+
+#ifdef _WIN32
+		void* file_handle = nullptr;
+		void* mapping_handle = nullptr;
+#else
+		int file_descriptor = -1;
+#endif
+
+		void close();
+
+	public:
+		// 打开并映射文件，失败时抛出 compiler_exception
+		source_file(const std::string& path);
+		~source_file() { close(); }
+
+		source_file(const source_file&) = delete;
+		source_file& operator=(const source_file&) = delete;
+
+		inline std::string_view view() const { return std::string_view(data, length); }
+		inline size_t size() const { return length; }
+	};
+}
@@ -5,198 +5,889 @@
 using namespace compiler;
 using namespace compiler::statement_parser;
 
-void compiler::statement_parser::node_value_identifier_replace(node_value* node, variable_scope& scope)
+void compiler::statement_parser::node_value_identifier_replace(parse_context& context, node_index root, const symbol_interner& symbols)
 {
-	if (node->node_type == node_value::node_identifier)
+	auto& tree = context.tree;
+
+	// ڽڵţ˳ɨ輴ɣݹ
+	// ӱʽʱñиĽڵ㣬Щڵ汾ǰʽһ
+	for (node_index i = tree.subtree_begin(root); i <= root; i++)
 	{
-		auto search = scope.search(node->identifier);
+		auto& node = tree[i];
+		if (node.node_type != node_value::node_identifier) continue;
+
+		const auto variable = context.scopes.find(node.identifier);
 
-		if (search)
-			node->val_identifier = search.value();
+		if (variable != invalid_variable)
+			node.left = node_index(variable);
 		else
-			throw syntax_parsing_exception(std::format("No identifier found in current scope: \"{0}\".", node->identifier));
+		{
+			const auto position = tree.identifier_positions[node.right];
+			context.diagnostics.emplace_back(position.line, position.character, std::format("No identifier found in current scope: \"{0}\".", symbols.name(node.identifier)));
+		}
+	}
+}
+
+// 뵱ǰ
+static void declare_variable(parse_context& context, declarement& decl, bool global, const symbol_interner& symbols)
+{
+	auto& variables = context.tree.variables;
+
+	decl.variable = variable_index(variables.size());
+	variables.emplace_back(decl.name, decl.type, global);
+
+	if (!context.scopes.declare(decl.name, decl.variable))
+		context.diagnostics.emplace_back(decl.position.line, decl.position.character, std::format("Variable \"{0}\" is already declared in this scope.", symbols.name(decl.name)));
+}
+
+// ֵֵֵ
+static void resolve_assignment(parse_context& context, assignment& assign, const symbol_interner& symbols)
+{
+	if (assign.type == assignment::variable)
+	{
+		assign.var_index = context.scopes.find(assign.var_name);
+
+		if (assign.var_index == invalid_variable)
+			context.diagnostics.emplace_back(assign.position.line, assign.position.character, std::format("No identifier found in current scope: \"{0}\".", symbols.name(assign.var_name)));
 	}
 	else
+		node_value_identifier_replace(context, assign.left, symbols);
+
+	node_value_identifier_replace(context, assign.right, symbols);
+}
+
+// ʽջ˳壻뺯β
+static void resolve_function(parse_context& context, const function_definition& function, const symbol_interner& symbols)
+{
+	auto& tree = context.tree;
+
+	// δ飬else 
+	struct open_block
+	{
+		uint32_t next, end;
+		const statement_range* else_body;
+	};
+
+	std::vector<open_block> blocks;
+
+	auto open = [&](const statement_range& range, const statement_range* else_body)
+	{
+		context.scopes.enter();
+		blocks.push_back({ range.begin, range.begin + range.count, else_body });
+	};
+
+	open(function.body, nullptr);
+
+	for (uint32_t i = 0; i < function.parameters.count; i++)
+		declare_variable(context, tree.declarements[function.parameters.begin + i], false, symbols);
+
+	while (!blocks.empty())
+	{
+		auto& block = blocks.back();
+
+		if (block.next == block.end)
+		{
+			const auto else_body = block.else_body;
+
+			context.scopes.exit();
+			blocks.pop_back();
+
+			if (else_body) open(*else_body, nullptr);
+			continue;
+		}
+
+		const auto statement = tree.statements[block.next++];
+
+		switch (statement.statement_type)
+		{
+		case statement_wrapper::decl:
+			declare_variable(context, tree.declarements[statement.index], false, symbols);
+			break;
+
+		case statement_wrapper::assign:
+			resolve_assignment(context, tree.assignments[statement.index], symbols);
+			break;
+
+		case statement_wrapper::if_statement:
+		{
+			const auto& branch = tree.branches[statement.index];
+
+			node_value_identifier_replace(context, branch.condition, symbols);
+			open(branch.body, branch.else_body.count ? &branch.else_body : nullptr);
+			break;
+		}
+
+		case statement_wrapper::while_loop:
+		{
+			const auto& loop = tree.loops[statement.index];
+
+			node_value_identifier_replace(context, loop.condition, symbols);
+			open(loop.body, nullptr);
+			break;
+		}
+
+		case statement_wrapper::return_statement:
+			if (statement.index != invalid_node)
+				node_value_identifier_replace(context, statement.index, symbols);
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+void compiler::statement_parser::resolve_program(parse_context& context, const symbol_interner& symbols)
+{
+	auto& tree = context.tree;
+
+	context.scopes.enter();
+
+	// ȫʼֻǳ˳
+	for (uint32_t i = 0; i < tree.globals.count; i++)
+	{
+		const auto statement = tree.statements[tree.globals.begin + i];
+
+		if (statement.statement_type == statement_wrapper::decl)
+			declare_variable(context, tree.declarements[statement.index], true, symbols);
+		else if (statement.statement_type == statement_wrapper::assign)
+			resolve_assignment(context, tree.assignments[statement.index], symbols);
+	}
+
+	for (const auto& function : tree.functions)
+		if (function.parsed)
+			resolve_function(context, function, symbols);
+
+	context.scopes.exit();
+}
+
+template<class list_type>
+bool compiler::statement_parser::skip_block(list_type& list, size_t& index, const parse_context& context)
+{
+	if (context.brackets)
+		if (const uint32_t match = (*context.brackets)[index]; match != bracket_table::no_match)
+		{
+			index = size_t(match) + 1;
+			return true;
+		}
+
+	// ƥδԣɨĩβ
+	size_t nesting = 0;
+
+	while (has_token(list, index))
+	{
+		const auto& tgt = list.at(index++);
+
+		if (tgt.match(token_type::left_bracket))
+			nesting++;
+		else if (tgt.match(token_type::right_bracket) && --nesting == 0)
+			return true;
+	}
+
+	return false;
+}
+
+template<class list_type>
+void compiler::statement_parser::synchronize(list_type& list, size_t& index, const parse_context& context)
+{
+	while (has_token(list, index))
+	{
+		const auto& tgt = list.at(index);
+
+		if (tgt.match(token_type::left_bracket))
+		{
+			if (!skip_block(list, index, context)) return;
+
+			if (token_is(list, index, keyword_type::kw_else))
+				index++;
+			else
+				return;
+		}
+		else if (tgt.match(token_type::right_bracket))
+			return; // 䴦
+		else if (tgt.match(token_type::semicolon))
+		{
+			index++;
+			return;
+		}
+		else
+			index++;
+	}
+}
+
+// 飺ǰǶײѹµһ
+template<class list_type>
+static bool open_block(list_type& list, size_t& index, parse_context& context, std::vector<block_frame>& frames, block_frame frame)
+{
+	if (!token_is(list, index, token_type::left_bracket))
 	{
-		if (node->left) node_value_identifier_replace(node->left, scope);
-		if (node->right) node_value_identifier_replace(node->right, scope);
+		context.report(list, index, "Statements should be enclosed by brackets");
+		return false;
 	}
+
+	if (frames.size() >= context.max_block_depth)
+	{
+		context.report(list, index, "Statements nested too deeply.");
+		return false;
+	}
+
+	index++;
+
+	frame.mark = context.pending.size();
+	frames.push_back(frame);
+	return true;
+}
+
+//  if ֧ while ѭ֣if (  )while (  )ʽʱ message
+template<class list_type>
+static parse_result<node_index> parse_condition(list_type& list, size_t& index, parse_context& context, const char* message)
+{
+	context.dag.reset();
+
+	if (!token_is(list, ++index, token_type::left_parentheses))
+	{
+		context.report(list, index, message);
+		return parse_result<node_index>::error();
+	}
+
+	auto condition = numeric_parser::parse_numeric_expression(list, ++index, context);
+	if (condition.failed()) return condition;
+
+	if (!token_is(list, index, token_type::right_parentheses))
+	{
+		context.report(list, index, message);
+		return parse_result<node_index>::error();
+	}
+
+	index++;
+	return condition;
 }
 
-void compiler::statement_parser::parse_statement_block(token_list& list, size_t& index, std::vector<statement_wrapper>& block, variable_scope* var_scope)
+// ʽջѴ򿪵鼰Ƕ׵ȫ飬ֱ
+//  if ֧ʱɹغ÷֧λ branches ĩβ
+template<class list_type>
+static parse_result<statement_range> parse_nested_blocks(list_type& list, size_t& index, parse_context& context, std::vector<block_frame>& frames)
 {
-	try
+	auto& pending = context.pending;
+	auto& tree = context.tree;
+	const size_t root_mark = frames.front().mark;
+
+	while (true)
 	{
-		// ǰ
-		if (!list.at(index++).match(token_type::left_bracket))
+		if (!has_token(list, index))
 		{
-			throw syntax_parsing_exception(list.at(index), "Statements should be enclosed by brackets");
+			context.report(list, index, "Unexpected end of input, \"}\" expected.");
+			pending.resize(root_mark);
+			return parse_result<statement_range>::error();
 		}
 
-		// 
-		while (!list.at(index).match(token_type::right_bracket))
+		bool failed = false;
+
+		switch (leading_statement(list.at(index)))
+		{
+		case statement_kind::block_end:
 		{
-			if (auto parse = parse_assignment(list, index); parse)
+			index++;
+
+			// ɣ
+			auto& frame = frames.back();
+			const statement_range range{ uint32_t(tree.statements.size()), uint32_t(pending.size() - frame.mark) };
+
+			tree.statements.insert(tree.statements.end(), pending.begin() + frame.mark, pending.end());
+			pending.resize(frame.mark);
+
+			// while ѭ
+			if (frame.is_loop)
 			{
-				block.push_back(statement_wrapper(statement_wrapper::assign, parse.value()));
+				frame.loop.body = range;
+				tree.loops.push_back(frame.loop);
+				frames.pop_back();
+
+				pending.push_back(statement_wrapper(statement_wrapper::while_loop, statement_index(tree.loops.size() - 1)));
 				continue;
 			}
 
-			if (auto parse = parse_declarement(list, index); parse)
+			if (!frame.is_branch)
+			{
+				frames.pop_back();
+				return parse_result<statement_range>::of(range);
+			}
+
+			if (!frame.in_else)
 			{
-				auto decl = std::get<0>(parse.value()); // 
-				auto assign = std::get<1>(parse.value()); // ֵ
+				frame.branch.body = range;
+
+				// elseֽñ
+				if (token_is(list, index, keyword_type::kw_else))
+				{
+					if (!token_is(list, ++index, token_type::left_bracket))
+					{
+						context.report(list, index, "Statements should be enclosed by brackets");
+						frames.pop_back();
+						failed = true;
+						break;
+					}
+
+					index++;
+					frame.in_else = true;
+					continue;
+				}
+			}
+			else
+				frame.branch.else_body = range;
 
-				block.push_back(statement_wrapper(statement_wrapper::decl, decl));
-				if (assign) block.push_back(statement_wrapper(statement_wrapper::assign, assign));
+			// if ֧
+			tree.branches.push_back(frame.branch);
+			frames.pop_back();
 
-				continue;
+			const auto branch = statement_index(tree.branches.size() - 1);
+			if (frames.empty()) return parse_result<statement_range>::of(range);
+
+			pending.push_back(statement_wrapper(statement_wrapper::if_statement, branch));
+			continue;
+		}
+
+		case statement_kind::assignment:
+			if (auto parse = parse_assignment(list, index, context); parse.succeeded())
+				pending.push_back(statement_wrapper(statement_wrapper::assign, parse.value));
+			else
+				failed = true;
+			break;
+
+		case statement_kind::declarement:
+			if (auto parse = parse_declarement(list, index, context); parse.succeeded())
+			{
+				auto [decl, assign] = parse.value; // ֵ
+
+				pending.push_back(statement_wrapper(statement_wrapper::decl, decl));
+				if (assign != invalid_statement) pending.push_back(statement_wrapper(statement_wrapper::assign, assign));
 			}
+			else
+				failed = true;
+			break;
 
-			if (auto parse = parse_if_branch(list, index); parse)
+		case statement_kind::if_branch:
+		{
+			auto condition = parse_condition(list, index, context, "Invalid if-branch grammar.");
+			if (condition.failed())
 			{
-				parse.value()->var_scope.parent = var_scope; // ĸΧ
-				block.push_back(statement_wrapper(statement_wrapper::if_statement, parse.value()));
-				continue;
+				failed = true;
+				break;
 			}
 
-			throw syntax_parsing_exception(list.at(index), "Unrecognized statement.");
+			// 岿ѹµһ
+			block_frame frame;
+			frame.is_branch = true;
+			frame.branch.condition = condition.value; // 
+
+			failed = !open_block(list, index, context, frames, frame);
+			break;
 		}
 
-		index++;
-	}
-	catch (std::exception)
-	{
-		throw syntax_parsing_exception("Parsing error, there's likely an incomplete statement in your code that caused subscription out of range.");
+		case statement_kind::while_loop:
+		{
+			auto condition = parse_condition(list, index, context, "Invalid while-loop grammar.");
+			if (condition.failed())
+			{
+				failed = true;
+				break;
+			}
+
+			block_frame frame;
+			frame.is_loop = true;
+			frame.loop.condition = condition.value;
+
+			failed = !open_block(list, index, context, frames, frame);
+			break;
+		}
+
+		case statement_kind::return_statement:
+			if (auto parse = parse_return(list, index, context); parse.succeeded())
+				pending.push_back(statement_wrapper(statement_wrapper::return_statement, parse.value));
+			else
+				failed = true;
+			break;
+
+		case statement_kind::function_definition:
+			context.report(list, index, "Functions can only be defined at the top level.");
+			failed = true;
+			break;
+
+		default:
+			context.report(list, index, "Unrecognized statement.");
+			failed = true;
+			break;
+		}
+
+		if (failed)
+		{
+			//  if ֧
+			if (frames.empty())
+			{
+				pending.resize(root_mark);
+				return parse_result<statement_range>::error();
+			}
+
+			synchronize(list, index, context);
+
+			// һֱ쵽ĩβʱظȱһ
+			if (!has_token(list, index))
+			{
+				pending.resize(root_mark);
+				return parse_result<statement_range>::error();
+			}
+		}
 	}
 }
 
-std::optional<assignment*> compiler::statement_parser::parse_assignment(token_list& list, size_t& index)
+template<class list_type>
+parse_result<statement_range> compiler::statement_parser::parse_statement_block(list_type& list, size_t& index, parse_context& context)
 {
-	auto node = new assignment();
+	std::vector<block_frame> frames;
 
-	if (list.at(index).match(token_type::identifier)) // ʶ
-	{
-		node->var_name = list.at(index++).literal;
-	}
-	else if (list.at(index).match(operand_type::get_address))
+	if (!open_block(list, index, context, frames, block_frame()))
+		return parse_result<statement_range>::error();
+
+	return parse_nested_blocks(list, index, context, frames);
+}
+
+template<class list_type>
+parse_result<statement_index> compiler::statement_parser::parse_assignment(list_type& list, size_t& index, parse_context& context)
+{
+	if (!has_token(list, index))
+		return parse_result<statement_index>::none();
+
+	const auto& first = list.at(index);
+
+	if (!first.match(token_type::identifier) && !first.match(operand_type::get_address))
+		return parse_result<statement_index>::none(); // ͷҲЧַ
+
+	context.dag.reset(); // ֵֵͬһ䣬ɹӱʽ
+
+	assignment node;
+
+	if (first.match(token_type::identifier)) // ʶ
 	{
-		node->left = numeric_parser::parse_numeric_expression(list, ++index);
+		node.type = assignment::variable;
+		node.var_name = first.symbol;
+		node.position = position_of(list, index);
+		index++;
 	}
 	else
 	{
-		delete node; // ͷҲЧַ
-		return std::nullopt;
+		auto left = numeric_parser::parse_numeric_expression(list, ++index, context);
+		if (left.failed()) return parse_result<statement_index>::error();
+
+		node.left = left.value;
 	}
 
 	// Ⱥ
-
-	if (index >= list.size()) throw syntax_parsing_exception("Invalid assignment statement.");
-
-	if (!list.at(index).match(operand_type::set_val))
+	if (!token_is(list, index, operand_type::set_val))
 	{
-		delete node; // ͷҲЧַ
-		throw syntax_parsing_exception(list.at(index), "Invalid assignment statement.");
+		context.report(list, index, "Invalid assignment statement.");
+		return parse_result<statement_index>::error();
 	}
 
-	node->right = numeric_parser::parse_numeric_expression(list, ++index, 0);
+	auto right = numeric_parser::parse_numeric_expression(list, ++index, context);
+	if (right.failed()) return parse_result<statement_index>::error();
+
+	node.right = right.value;
 
 	// β
-	if (index < list.size())
-		if (list.at(index).match(token_type::semicolon))
-		{
-			// Ч
-			index++;
-			return node;
-		}
+	if (!token_is(list, index, token_type::semicolon))
+	{
+		context.report(list, index, "Invalid assignment statement. End the statement with \";\".");
+		return parse_result<statement_index>::error();
+	}
+
+	index++;
 
-	// Ч
-	delete node;
-	throw syntax_parsing_exception(list.at(index).character, list.at(index).line, 
-		"Invalid assignment statement. End the statement with \";\".");
+	context.tree.assignments.push_back(node);
+	return parse_result<statement_index>::of(statement_index(context.tree.assignments.size() - 1));
 }
 
-std::optional<std::tuple<declarement*, assignment*>> compiler::statement_parser::parse_declarement(token_list& list, size_t& index, bool global)
+template<class list_type>
+parse_result<std::tuple<statement_index, statement_index>> compiler::statement_parser::parse_declarement(list_type& list, size_t& index, parse_context& context, bool global)
 {
+	using result = parse_result<std::tuple<statement_index, statement_index>>;
+
 	// 
-	if (!list.at(index).match(token_type::number_type))
-		return std::nullopt;
+	if (!token_is(list, index, token_type::number_type))
+		return result::none();
 
-	declarement* decl = new declarement();
-	decl->type = list.at(index).number_type;
-	decl->name = list.at(index).literal;
+	context.dag.reset();
+
+	declarement decl;
+	decl.type = list.at(index).number_type;
 
 	// 
-	if (++index >= list.size()) throw syntax_parsing_exception("Invalid variable declarement."); // Խ
+	if (!token_is(list, ++index, token_type::identifier))
+	{
+		context.report(list, index, "Invalid variable declarement.");
+		return result::error();
+	}
 
-	if (!list.at(index).match(token_type::identifier))
-		throw syntax_parsing_exception(list.at(index), "Invalid variable declarement.");
+	decl.name = list.at(index).symbol;
+	decl.position = position_of(list, index);
 
-	auto& tok = list.at(index); // 
-	
-	assignment* ret = nullptr;
+	std::optional<assignment> ret;
 
 	// ǷԴֵ
-	if (++index >= list.size()) throw syntax_parsing_exception("Invalid variable declarement."); // Խ
-
-	if (list.at(index).match(operand_type::set_val))
+	if (token_is(list, ++index, operand_type::set_val))
 	{
-		ret = new assignment();
+		ret.emplace();
+		ret->type = assignment::variable;
+		ret->var_name = decl.name;
+		ret->position = decl.position;
 
 		// ʽ
-		ret->right = numeric_parser::parse_numeric_expression(list, ++index);
+		auto right = numeric_parser::parse_numeric_expression(list, ++index, context);
+		if (right.failed()) return result::error();
+
+		ret->right = right.value;
 
 		// ȫֱӳʼ
-		if (ret->right->node_type != node_value::node_constant && global)
-			throw syntax_parsing_exception(list.at(index), "Invalid global variable initialization.");
+		if (context.tree[ret->right].node_type != node_value::node_constant && global)
+		{
+			context.report(list, index, "Invalid global variable initialization.");
+			return result::error();
+		}
 	}
 
-	if (index >= list.size()) throw syntax_parsing_exception("Invalid variable declarement."); // Խ
-
 	// βֺ
-	if (!list.at(index).match(token_type::semicolon))
+	if (!token_is(list, index, token_type::semicolon))
 	{
-		if (ret) delete ret;
-		throw syntax_parsing_exception(list.at(index), "Invalid variable declarement.");
+		context.report(list, index, "Invalid variable declarement.");
+		return result::error();
 	}
 
 	index++;
 
-	return std::tuple(decl, ret);
+	auto& tree = context.tree;
+	tree.declarements.push_back(decl);
+
+	statement_index assign = invalid_statement;
+	if (ret)
+	{
+		tree.assignments.push_back(ret.value());
+		assign = statement_index(tree.assignments.size() - 1);
+	}
+
+	return result::of(std::tuple(statement_index(tree.declarements.size() - 1), assign));
 }
 
-std::optional<if_branch*> compiler::statement_parser::parse_if_branch(token_list& list, size_t& index)
+template<class list_type>
+parse_result<statement_index> compiler::statement_parser::parse_if_branch(list_type& list, size_t& index, parse_context& context)
 {
-	if (!list.at(index).match(keyword_type::kw_if))
+	if (!token_is(list, index, keyword_type::kw_if))
+	{
+		return parse_result<statement_index>::none();
+	}
+
+	auto condition = parse_condition(list, index, context, "Invalid if-branch grammar.");
+	if (condition.failed()) return parse_result<statement_index>::error();
+
+	std::vector<block_frame> frames;
+
+	block_frame frame;
+	frame.is_branch = true;
+	frame.branch.condition = condition.value; // 
+
+	if (!open_block(list, index, context, frames, frame))
+		return parse_result<statement_index>::error();
+
+	if (parse_nested_blocks(list, index, context, frames).failed())
+		return parse_result<statement_index>::error();
+
+	return parse_result<statement_index>::of(statement_index(context.tree.branches.size() - 1));
+}
+
+template<class list_type>
+parse_result<node_index> compiler::statement_parser::parse_return(list_type& list, size_t& index, parse_context& context)
+{
+	if (!token_is(list, index, keyword_type::kw_return))
+		return parse_result<node_index>::none();
+
+	context.dag.reset();
+
+	// ޷ֵ
+	if (token_is(list, ++index, token_type::semicolon))
+	{
+		index++;
+		return parse_result<node_index>::of(invalid_node);
+	}
+
+	auto value = numeric_parser::parse_numeric_expression(list, index, context);
+	if (value.failed()) return value;
+
+	if (!token_is(list, index, token_type::semicolon))
+	{
+		context.report(list, index, "Invalid return statement. End the statement with \";\".");
+		return parse_result<node_index>::error();
+	}
+
+	index++;
+	return value;
+}
+
+template<class list_type>
+parse_result<uint32_t> compiler::statement_parser::parse_function(list_type& list, size_t& index, parse_context& context)
+{
+	if (!token_is(list, index, keyword_type::kw_func))
+		return parse_result<uint32_t>::none();
+
+	auto& tree = context.tree;
+	function_definition function;
+
+	auto fail = [&]()
 	{
-		return std::nullopt;
+		context.report(list, index, "Invalid function definition.");
+		return parse_result<uint32_t>::error();
+	};
+
+	// 
+	if (!token_is(list, ++index, token_type::identifier)) return fail();
+	function.name = list.at(index).symbol;
+
+	// βб
+	if (!token_is(list, ++index, token_type::left_parentheses)) return fail();
+
+	function.parameters.begin = uint32_t(tree.declarements.size());
+
+	if (!token_is(list, ++index, token_type::right_parentheses))
+		while (true)
+		{
+			if (!token_is(list, index, token_type::number_type)) return fail();
+
+			declarement parameter;
+			parameter.type = list.at(index).number_type;
+
+			if (!token_is(list, ++index, token_type::identifier)) return fail();
+
+			parameter.name = list.at(index).symbol;
+			parameter.position = position_of(list, index);
+			tree.declarements.push_back(parameter);
+
+			if (token_is(list, ++index, token_type::separator))
+			{
+				index++;
+				continue;
+			}
+
+			if (token_is(list, index, token_type::right_parentheses))
+				break;
+
+			return fail();
+		}
+
+	function.parameters.count = uint32_t(tree.declarements.size() - function.parameters.begin);
+
+	// 
+	if (token_is(list, ++index, operand_type::explanation))
+	{
+		if (!token_is(list, ++index, token_type::number_type)) return fail();
+
+		function.return_type = list.at(index).number_type;
+		index++;
 	}
 
-	if (!list.at(++index).match(token_type::left_parentheses))
+	// 
+	if (!token_is(list, index, token_type::left_bracket))
 	{
-		throw syntax_parsing_exception(list.at(index), "Invalid if-branch grammar.");
+		context.report(list, index, "Statements should be enclosed by brackets");
+		return parse_result<uint32_t>::error();
 	}
 
-	auto condition = numeric_parser::parse_numeric_expression(list, ++index);
+	function.body_token = uint32_t(index);
+
+	tree.functions.push_back(function);
+	const auto function_index = uint32_t(tree.functions.size() - 1);
+
+	if (is_random_access<list_type> && context.lazy_functions)
+	{
+		// ݲ
+		if (!skip_block(list, index, context))
+		{
+			context.report(list, index, "Unexpected end of input, \"}\" expected.");
+
+			// δպϣΪѽĿպ壬ⰴʱظ
+			auto& definition = tree.functions[function_index];
+			definition.parsed = true;
+			definition.node_begin = definition.node_end = node_index(tree.nodes.size());
+			return parse_result<uint32_t>::error();
+		}
+	}
+	else
+	{
+		const auto node_begin = node_index(tree.nodes.size());
+		auto body = parse_statement_block(list, index, context);
+
+		auto& definition = tree.functions[function_index];
+		definition.parsed = true;
+		definition.body = body.value;
+		definition.node_begin = node_begin;
+		definition.node_end = node_index(tree.nodes.size());
+
+		if (body.failed()) return parse_result<uint32_t>::error();
+	}
+
+	return parse_result<uint32_t>::of(function_index);
+}
+
+template<class list_type>
+void compiler::statement_parser::parse_top_level(list_type& list, size_t& index, parse_context& context)
+{
+	auto& pending = context.pending;
+	bool failed = false;
 
-	if (!list.at(index).match(token_type::right_parentheses))
+	switch (leading_statement(list.at(index)))
 	{
-		throw syntax_parsing_exception(list.at(index), "Invalid if-branch grammar.");
+	case statement_kind::declarement:
+		if (auto parse = parse_declarement(list, index, context, true); parse.succeeded())
+		{
+			auto [decl, assign] = parse.value; // ֵ
+
+			pending.push_back(statement_wrapper(statement_wrapper::decl, decl));
+			if (assign != invalid_statement) pending.push_back(statement_wrapper(statement_wrapper::assign, assign));
+		}
+		else
+			failed = true;
+		break;
+
+	case statement_kind::function_definition:
+		failed = parse_function(list, index, context).failed();
+		break;
+
+	case statement_kind::block_end: // һţͬ޷Խֱ
+		context.report(list, index, "Unexpected \"}\".");
+		index++;
+		break;
+
+	default:
+		context.report(list, index, "Only declarements and functions are allowed at the top level.");
+		failed = true;
+		break;
 	}
 
-	auto branch_instance = new if_branch();
+	if (failed) synchronize(list, index, context);
+}
+
+template<class list_type>
+parse_result<statement_range> compiler::statement_parser::parse_program(list_type& list, size_t& index, parse_context& context)
+{
+	auto& pending = context.pending;
+	const size_t mark = pending.size();
+
+	while (has_token(list, index))
+		parse_top_level(list, index, context);
+
+	// ȫ
+	auto& tree = context.tree;
+	const statement_range range{ uint32_t(tree.statements.size()), uint32_t(pending.size() - mark) };
 
-	branch_instance->condition = condition; // 
-	parse_statement_block(list, ++index, branch_instance->body, &branch_instance->var_scope); // 
+	tree.statements.insert(tree.statements.end(), pending.begin() + mark, pending.end());
+	pending.resize(mark);
+
+	tree.globals = range;
+	return parse_result<statement_range>::of(range);
+}
+
+template<class list_type>
+parse_result<statement_range> compiler::statement_parser::parse_function_body(list_type& list, parse_context& context, uint32_t function)
+{
+	auto& tree = context.tree;
 
-	// elseֽ
-	if(index < list.size()) if (list.at(index).match(keyword_type::kw_else))
+	if (tree.functions[function].parsed)
+		return parse_result<statement_range>::of(tree.functions[function].body);
+
+	size_t index = tree.functions[function].body_token;
+	const auto node_begin = node_index(tree.nodes.size());
+
+	auto body = parse_statement_block(list, index, context);
+
+	// ʱͬΪѽظ
+	auto& definition = tree.functions[function];
+	definition.parsed = true;
+	definition.body = body.value;
+	definition.node_begin = node_begin;
+	definition.node_end = node_index(tree.nodes.size());
+
+	return body;
+}
+
+template<class list_type>
+size_t compiler::statement_parser::parse_reachable_functions(list_type& list, parse_context& context, symbol_id entry)
+{
+	auto& tree = context.tree;
+
+	// ͬȡȶ
+	std::unordered_map<symbol_id, uint32_t> lookup;
+	for (uint32_t i = 0; i < tree.functions.size(); i++)
+		lookup.try_emplace(tree.functions[i].name, i);
+
+	std::vector<uint32_t> worklist;
+	if (auto find = lookup.find(entry); find != lookup.end())
+		worklist.push_back(find->second);
+
+	size_t count = 0;
+
+	while (!worklist.empty())
 	{
-		branch_instance->else_var_scope = variable_scope(); // elseռ
+		const uint32_t function = worklist.back();
+		worklist.pop_back();
+
+		if (tree.functions[function].parsed) continue;
+
+		parse_function_body(list, context, function);
+		count++;
 
-		// else
-		parse_statement_block(list, ++index, branch_instance->else_body, &branch_instance->else_var_scope.value());
+		// ڵĵ
+		const auto& definition = tree.functions[function];
+		for (node_index i = definition.node_begin; i < definition.node_end; i++)
+		{
+			const auto& node = tree[i];
+			if (node.node_type != node_value::node_function) continue;
+
+			if (auto find = lookup.find(node.identifier); find != lookup.end() && !tree.functions[find->second].parsed)
+				worklist.push_back(find->second);
+		}
 	}
 
-	return branch_instance;
+	return count;
 }
+
+// ʽʵ
+template bool compiler::statement_parser::skip_block(token_list& list, size_t& index, const parse_context& context);
+template bool compiler::statement_parser::skip_block(token_stream& list, size_t& index, const parse_context& context);
+template bool compiler::statement_parser::skip_block(token_reader& list, size_t& index, const parse_context& context);
+template void compiler::statement_parser::synchronize(token_list& list, size_t& index, const parse_context& context);
+template void compiler::statement_parser::synchronize(token_stream& list, size_t& index, const parse_context& context);
+template void compiler::statement_parser::synchronize(token_reader& list, size_t& index, const parse_context& context);
+template parse_result<statement_range> compiler::statement_parser::parse_statement_block(token_list& list, size_t& index, parse_context& context);
+template parse_result<statement_range> compiler::statement_parser::parse_statement_block(token_stream& list, size_t& index, parse_context& context);
+template parse_result<statement_range> compiler::statement_parser::parse_statement_block(token_reader& list, size_t& index, parse_context& context);
+template parse_result<statement_index> compiler::statement_parser::parse_assignment(token_list& list, size_t& index, parse_context& context);
+template parse_result<statement_index> compiler::statement_parser::parse_assignment(token_stream& list, size_t& index, parse_context& context);
+template parse_result<statement_index> compiler::statement_parser::parse_assignment(token_reader& list, size_t& index, parse_context& context);
+template parse_result<std::tuple<statement_index, statement_index>> compiler::statement_parser::parse_declarement(token_list& list, size_t& index, parse_context& context, bool global);
+template parse_result<std::tuple<statement_index, statement_index>> compiler::statement_parser::parse_declarement(token_stream& list, size_t& index, parse_context& context, bool global);
+template parse_result<std::tuple<statement_index, statement_index>> compiler::statement_parser::parse_declarement(token_reader& list, size_t& index, parse_context& context, bool global);
+template parse_result<statement_index> compiler::statement_parser::parse_if_branch(token_list& list, size_t& index, parse_context& context);
+template parse_result<statement_index> compiler::statement_parser::parse_if_branch(token_stream& list, size_t& index, parse_context& context);
+template parse_result<statement_index> compiler::statement_parser::parse_if_branch(token_reader& list, size_t& index, parse_context& context);
+template parse_result<node_index> compiler::statement_parser::parse_return(token_list& list, size_t& index, parse_context& context);
+template parse_result<node_index> compiler::statement_parser::parse_return(token_stream& list, size_t& index, parse_context& context);
+template parse_result<node_index> compiler::statement_parser::parse_return(token_reader& list, size_t& index, parse_context& context);
+template parse_result<uint32_t> compiler::statement_parser::parse_function(token_list& list, size_t& index, parse_context& context);
+template parse_result<uint32_t> compiler::statement_parser::parse_function(token_stream& list, size_t& index, parse_context& context);
+template parse_result<uint32_t> compiler::statement_parser::parse_function(token_reader& list, size_t& index, parse_context& context);
+template void compiler::statement_parser::parse_top_level(token_list& list, size_t& index, parse_context& context);
+template void compiler::statement_parser::parse_top_level(token_stream& list, size_t& index, parse_context& context);
+template void compiler::statement_parser::parse_top_level(token_reader& list, size_t& index, parse_context& context);
+template parse_result<statement_range> compiler::statement_parser::parse_program(token_list& list, size_t& index, parse_context& context);
+template parse_result<statement_range> compiler::statement_parser::parse_program(token_stream& list, size_t& index, parse_context& context);
+template parse_result<statement_range> compiler::statement_parser::parse_program(token_reader& list, size_t& index, parse_context& context);
+template parse_result<statement_range> compiler::statement_parser::parse_function_body(token_list& list, parse_context& context, uint32_t function);
+template parse_result<statement_range> compiler::statement_parser::parse_function_body(token_stream& list, parse_context& context, uint32_t function);
+template size_t compiler::statement_parser::parse_reachable_functions(token_list& list, parse_context& context, symbol_id entry);
+template size_t compiler::statement_parser::parse_reachable_functions(token_stream& list, parse_context& context, symbol_id entry);
\ No newline at end of file
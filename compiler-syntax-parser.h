@@ -4,6 +4,9 @@
 
 #include "compiler-head.h"
 #include "compiler-base.h"
+#include "compiler-token-stream.h"
+#include "compiler-tokenizer.h"
+#include "compiler-constant-folding.h"
 
 namespace compiler
 {
@@ -12,122 +15,324 @@ namespace compiler
 		using compiler_exception::compiler_exception; // ̳й캯
 	};
 
+	// ԴԪΪģɽ token_listtoken_stream  token_reader
+	// ṩ at()at()  token  token_viewǷ񵽴ĩβͳһ has_token() ж
+
+	// Ϊ index ĴԪǷ
+	template<class list_type>
+	inline bool has_token(const list_type& list, size_t index) { return index < list.size(); }
+
+	// ȡʽʷɨ
+	inline bool has_token(const token_reader& list, size_t index) { return list.fill(index); }
+
+	// ɻصԽλõĴԪ֧ӳٽ壻ȡʽʷֻǰ
+	template<class list_type>
+	constexpr bool is_random_access = !std::is_same_v<std::remove_const_t<list_type>, token_reader>;
+
+	// Ϊ index ĴԪƥ
+	template<class list_type, class match_type>
+	inline bool token_is(const list_type& list, size_t index, match_type what) { return has_token(list, index) && list.at(index).match(what); }
+
+	// Ϊ index ĴԪλãǰȷϴԪ
+	template<class list_type>
+	inline source_position position_of(const list_type& list, size_t index)
+	{
+		const auto& t = list.at(index);
+
+		if constexpr (requires { t.position(); })
+		{
+			const auto [line, character] = t.position();
+			return { uint32_t(line), uint32_t(character) };
+		}
+		else
+			return { uint32_t(t.line), uint32_t(t.character) };
+	}
+
+	// 
+	// - successɹvalue Ч
+	// - mismatchǰλòǴ䣬δ¼ϣ÷ɳ
+	// - failure﷨Ѽ parse_context::diagnosticsɵ÷ָ
+	template<class T>
+	struct parse_result
+	{
+		enum status_type : uint8_t
+		{
+			success,
+			mismatch,
+			failure
+		};
+
+		status_type status = mismatch;
+		T value{};
+
+	public:
+		static inline parse_result of(T value) { return { success, value }; }
+		static inline parse_result none() { return { mismatch, T{} }; }
+		static inline parse_result error() { return { failure, T{} }; }
+
+		inline bool succeeded() const { return status == success; }
+		inline bool matched() const { return status != mismatch; }
+		inline bool failed() const { return status == failure; }
+	};
+
 	// ֵʽ
 	namespace numeric_parser
 	{
-		// ʽ
-		node_value* parse_numeric_expression(const token_list& list, size_t& index, size_t depth = 0);
+		// ȼ
+		struct operator_precedence
+		{
+			uint8_t binary = 0; // ԪԽԽȽϣ0 ʾǶԪͬ
+			uint8_t prefix = 0; // ǰ׺㼶ֻٴ㼶͵ǰ׺0 ʾǰ׺
+		};
 
-		// Ԫģ
-		template<operand_type... type>
-		node_value* parse_double_operand(const token_list& list, size_t& index, std::function<node_value*(const token_list&, size_t&, size_t)> func, size_t depth)
+		//  operand_type ȼ
+		constexpr std::array<operator_precedence, size_t(operand_type::explanation) + 1> precedence_table = []
 		{
-			auto node = func(list, index, depth);
+			std::array<operator_precedence, size_t(operand_type::explanation) + 1> table{};
 
-			while (1)
+			auto binary = [&](uint8_t power, std::initializer_list<operand_type> ops)
 			{
-				if (index >= list.size())
-					return node;
+				for (auto op : ops) table[size_t(op)].binary = power;
+			};
 
-				auto& operand = list.at(index);
+			binary(8, { operand_type::mul, operand_type::div, operand_type::mod });
+			binary(7, { operand_type::add, operand_type::sub });
+			binary(6, { operand_type::bit_lsh, operand_type::bit_rsh });
+			binary(5, { operand_type::smaller, operand_type::smaller_or_equal, operand_type::larger, operand_type::larger_or_equal });
+			binary(4, { operand_type::equal, operand_type::not_equal });
+			binary(3, { operand_type::bit_and });
+			binary(2, { operand_type::bit_xor });
+			binary(1, { operand_type::bit_or });
 
-				if (operand.type == token_type::right_parentheses || operand.type == token_type::semicolon)
-					return node;
+			table[size_t(operand_type::bit_not)].prefix = 2; // !@x Ϸ!!x  @!x Ϸ
+			table[size_t(operand_type::get_address)].prefix = 1;
 
-				if (operand.type != token_type::double_operand)
-					return node;
+			return table;
+		}();
 
-				if (((operand.op_type == type)||...))
-				{
-					auto right = func(list, ++index, depth);
+		// ջԪأԼĶԪδڲǰ׺
+		struct pending_operator
+		{
+			operand_type op_type;
+			uint8_t binary; // Ԫ0 ʾǰ׺
+		};
 
-					auto new_node = new node_value();
-					new_node->left = node;
-					new_node->right = right;
-					new_node->node_type = node_value::node_operator;
-					new_node->op_type = operand.op_type;
-					node = new_node;
+		// Ƕײ㣺ʽһŻһκõһ
+		struct expression_frame
+		{
+			enum frame_type : uint8_t
+			{
+				root,
+				parentheses,
+				call
+			};
 
-					continue;
-				}
+			frame_type type;
+			uint32_t operator_base; // ջе
+			uint32_t argument_base; // ãѽ arguments е
+			symbol_id function; // ã
+		};
 
-				return node;
-			}
-		}
+		// ʽõʽջʽãռڴʽȳȣǶײ parse_context::max_expression_depth 
+		struct expression_stack
+		{
+			std::vector<node_index> operands;
+			std::vector<pending_operator> operators;
+			std::vector<expression_frame> frames;
+			std::vector<node_index> arguments;
+		};
 
-		// һԪģ
-		template<operand_type... type>
-		node_value* parse_single_operand(const token_list& list, size_t& index, std::function<node_value* (const token_list&, size_t&, size_t)> func, size_t depth)
+		// ʽʽʱ (node_type, op_type, value, left, right) ϲͬĴڵ㣬ͬӱʽֻһڵ
+		// ֻͬһںϲܱ֮¸ֵȡַ뺯õĽڵ㲻ϲϲڵҲͲᱻϲ
+		// ѰַλΣʱֻΣҲͷ
+		struct expression_dag
 		{
-			auto& operand = list.at(index);
+			struct slot
+			{
+				node_index node = invalid_node;
+				uint32_t generation = 0;
+			};
+
+			std::vector<slot> slots; // Ϊ2
+			uint32_t generation = 1;
+			size_t count = 0; // ѺϲĽڵ
+
+		public:
+			// ʼµ
+			void reset();
+
+			//  node ͬнڵ㣬ûʱ﷨
+			node_index intern(syntax_tree& tree, const node_value& node);
+		};
+	}
+
+	// ģһα빲ãбƽ﷨Ϣƽõķű
+	struct parse_context
+	{
+		syntax_tree tree;
+		symbol_table scopes;
 
-			if (operand.type == token_type::single_operand)
-				if (((operand.op_type == type) || ...))
-				{
-					auto val_node = func(list, ++index, depth);
-					auto node = new node_value();
-					node->node_type = node_value::node_operator;
-					node->op_type = operand.op_type;
-					node->left = val_node;
+		std::vector<syntax_parsing_exception> diagnostics; // ȫ﷨󣬰˳
 
-					return node;
-				}
+		std::vector<statement_wrapper> pending; // δɵ飬ڲλջ
+		numeric_parser::expression_stack expression; // ʽջ
+		numeric_parser::expression_dag dag; // ͬһڵıʽ
 
-			return func(list, index, depth);
+		size_t max_expression_depth = 256; // ʽ뺯õǶײ
+		size_t max_block_depth = 256; // Ƕײ
+
+		const bracket_table* brackets = nullptr; // ԪƥΪʱԪɨ
+		bool lazy_functions = true; // ʱ壬Ҫʱٽ
+		bool fold_constants = true; // ʽʱ۵
+		bool share_subexpressions = false; // ͬһͬӱʽýڵ㣬ʱñиĽڵ
+
+	public:
+		// ¼λڴԪ index ﷨ԽĩβʱȡһԪλ
+		template<class list_type>
+		void report(const list_type& list, size_t index, std::string msg)
+		{
+			if (has_token(list, index))
+				diagnostics.emplace_back(list.at(index), std::move(msg));
+			else if (index > 0 && has_token(list, index - 1))
+				diagnostics.emplace_back(list.at(index - 1), std::move(msg));
+			else
+				diagnostics.emplace_back(std::move(msg));
 		}
+	};
 
-		// ȡڴȼ0
-		node_value* parse_priority0(const token_list& list, size_t& index, size_t depth);
+	namespace numeric_parser
+	{
+		// ʽʽջȼǶȵݹ
+		template<class list_type>
+		parse_result<node_index> parse_numeric_expression(const list_type& list, size_t& index, parse_context& context);
+	}
 
-		// λȼ1
-		node_value* parse_priority1(const token_list& list, size_t& index, size_t depth);
+	namespace statement_parser
+	{
+		// ࣬׸ԪΨһȷ
+		enum class statement_kind : uint8_t
+		{
+			unknown = 0, // ޷Ϊ俪ͷ
+			assignment,
+			declarement,
+			if_branch,
+			while_loop,
+			return_statement,
+			function_definition, // ֻλڶ
+			block_end // һţ
+		};
 
-		// ˳ȡ࣬ȼ2
-		node_value* parse_priority2(const token_list& list, size_t& index, size_t depth);
+		//  token_type ɱؼ뵥Ŀ밴ϸ
+		constexpr std::array<statement_kind, size_t(token_type::separator) + 1> token_dispatch_table = []
+		{
+			std::array<statement_kind, size_t(token_type::separator) + 1> table{};
 
-		// Ӽȼ3
-		node_value* parse_priority3(const token_list& list, size_t& index, size_t depth);
+			table[size_t(token_type::identifier)] = statement_kind::assignment;
+			table[size_t(token_type::number_type)] = statement_kind::declarement;
+			table[size_t(token_type::right_bracket)] = statement_kind::block_end;
 
-		// λȼ4
-		node_value* parse_priority4(const token_list& list, size_t& index, size_t depth);
+			return table;
+		}();
 
-		// Сϵȼ5
-		node_value* parse_priority5(const token_list& list, size_t& index, size_t depth);
+		//  keyword_type ɱ
+		constexpr std::array<statement_kind, size_t(keyword_type::kw_else) + 1> keyword_dispatch_table = []
+		{
+			std::array<statement_kind, size_t(keyword_type::kw_else) + 1> table{};
 
-		// /ȣȼ6
-		node_value* parse_priority6(const token_list& list, size_t& index, size_t depth);
+			table[size_t(keyword_type::kw_if)] = statement_kind::if_branch;
+			table[size_t(keyword_type::kw_while)] = statement_kind::while_loop;
+			table[size_t(keyword_type::kw_return)] = statement_kind::return_statement;
+			table[size_t(keyword_type::kw_func)] = statement_kind::function_definition;
 
-		// λ룬ȼ7
-		node_value* parse_priority7(const token_list& list, size_t& index, size_t depth);
+			return table;
+		}();
 
-		// λȼ8
-		node_value* parse_priority8(const token_list& list, size_t& index, size_t depth);
+		// ׸Ԫȷ
+		inline statement_kind leading_statement(const token_base& first)
+		{
+			switch (first.type)
+			{
+			case token_type::keyword:
+				return keyword_dispatch_table[size_t(first.key_type)];
 
-		// λȼ9
-		node_value* parse_priority9(const token_list& list, size_t& index, size_t depth);
+			case token_type::single_operand: // ȡַͷĸֵ@x = ...
+				return first.op_type == operand_type::get_address ? statement_kind::assignment : statement_kind::unknown;
 
-		// //
-		node_value* parse_number(const token_list& list, size_t& index, size_t depth);
-	}
+			default:
+				return token_dispatch_table[size_t(first.type)];
+			}
+		}
 
-	namespace statement_parser
-	{
-		// 滻
-		void node_value_identifier_replace(node_value* node, variable_scope& scope);
+		// 滻еıʶΪǰɼıҲʱ¼
+		void node_value_identifier_replace(parse_context& context, node_index root, const symbol_interner& symbols);
+
+		// ƽȰ˳ȫֱѽеıÿһβ뺯ͬһ
+		// дʶڵ㡢ֵȫ syntax_tree::variablesÿֻһ
+		void resolve_program(parse_context& context, const symbol_interner& symbols);
+
+		// δ飻if ֧ else Ⱥռͬһ
+		struct block_frame
+		{
+			size_t mark = 0; //  pending е
+
+			bool is_branch = false; // Ƿ if ֧
+			bool is_loop = false; // Ƿ while ѭ߾ʱΪ
+			bool in_else = false; // ڽ else 
+			if_branch branch; //  if ֧ else ־д branches
+			while_loop loop; //  while ѭд loops
+		};
+
+		//  index ſʼ飬ͣԵһ֮ƥʱ O(1)δʱ false
+		template<class list_type>
+		bool skip_block(list_type& list, size_t& index, const parse_context& context);
+
+		// ͬǰֱֺ֮󣬻ͣһǰ;飨ͬ else ֣
+		template<class list_type>
+		void synchronize(list_type& list, size_t& index, const parse_context& context);
 		
-		// 
-		void parse_statement_block(token_list& list, size_t& index, std::vector<statement_wrapper>& block, variable_scope* var_scope);
+		// 飬е䣻׸Ԫɸ䣬ʱ¼ϲһ
+		// Ƕ׵ʽջ parse_context::max_block_depth 
+		template<class list_type>
+		parse_result<statement_range> parse_statement_block(list_type& list, size_t& index, parse_context& context);
 
-		// ֵʽ
-		std::optional<assignment*> parse_assignment(token_list& list, size_t& index);
+		// ֵʽ assignments еı
+		template<class list_type>
+		parse_result<statement_index> parse_assignment(list_type& list, size_t& index, parse_context& context);
 
-		// ; 
-		// - ʧܣ std::nullopt; 
-		// - ɹ޸ֵʱ nullptr, 򷵻ؾ帳ֵڵ
-		std::optional<std::tuple<declarement*, assignment*>> parse_declarement(token_list& list, size_t& index, bool global = false);
+		// 䣬븳ֵţ޸ֵʱֵΪ invalid_statement
+		template<class list_type>
+		parse_result<std::tuple<statement_index, statement_index>> parse_declarement(list_type& list, size_t& index, parse_context& context, bool global = false);
 		
-		// if֧
-		std::optional<if_branch*> parse_if_branch(token_list& list, size_t& index);
+		// if֧䣬 branches еı
+		template<class list_type>
+		parse_result<statement_index> parse_if_branch(list_type& list, size_t& index, parse_context& context);
+
+		// 䣬طֵĽڵţ޷ֵʱΪ invalid_node
+		template<class list_type>
+		parse_result<node_index> parse_return(list_type& list, size_t& index, parse_context& context);
+
+		// 壺func ( β, ...) [: ] { ... } functions еı
+		// ʵ lazy_functions Ϊʱֻ¼λòȡʽʷ޷ͷ
+		// ӳԺΪλ if  while 溯һ
+		template<class list_type>
+		parse_result<uint32_t> parse_function(list_type& list, size_t& index, parse_context& context);
+
+		// һ﷨Ԫȫ壩ȫѹ parse_context::pendingʱ¼ϲͬһԪ
+		// һԪǰȷ index дԪ
+		template<class list_type>
+		void parse_top_level(list_type& list, size_t& index, parse_context& context);
+
+		// 򣺶ֻȫ뺯壬ȫд syntax_tree::globals
+		template<class list_type>
+		parse_result<statement_range> parse_program(list_type& list, size_t& index, parse_context& context);
+
+		// δĺ壬ѽʱֱӷأlist ΪúʱõĿ
+		template<class list_type>
+		parse_result<statement_range> parse_function_body(list_type& list, parse_context& context, uint32_t function);
+
+		// ںеĵɴĺ壬رνĺҲںʱ 0
+		template<class list_type>
+		size_t parse_reachable_functions(list_type& list, parse_context& context, symbol_id entry);
 	
 	}
 }
\ No newline at end of file
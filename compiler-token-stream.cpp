@@ -0,0 +1,49 @@
+// compiler-token-stream.cpp: 紧凑词元流
+
+#include "compiler-token-stream.h"
+
+using namespace compiler;
+
+void compiler::token_stream::push_back(const token_base& t, uint32_t offset, uint32_t literal_length)
+{
+	types.push_back(uint8_t(t.type) | (t.white_space ? white_space_flag : 0));
+	offsets.push_back(offset);
+
+	switch (t.type)
+	{
+	case token_type::keyword:
+		subtypes.push_back(uint8_t(t.key_type));
+		payloads.push_back(literal_length);
+		break;
+
+	case token_type::number_type:
+		subtypes.push_back(uint8_t(t.number_type));
+		payloads.push_back(literal_length);
+		break;
+
+	case token_type::identifier:
+		subtypes.push_back(0);
+		payloads.push_back(t.symbol);
+		break;
+
+	case token_type::number:
+		subtypes.push_back(uint8_t(t.number_type));
+		payloads.push_back(t.number_data.uint_number);
+		break;
+
+	default:
+		subtypes.push_back(uint8_t(t.op_type));
+		payloads.push_back(0);
+		break;
+	}
+}
+
+std::pair<size_t, size_t> compiler::token_stream::position(size_t index) const
+{
+	const uint32_t offset = offsets.at(index);
+
+	// 最后一个不大于偏移的行首
+	auto line = std::upper_bound(line_starts.begin(), line_starts.end(), offset) - line_starts.begin() - 1;
+
+	return { size_t(line), size_t(offset - line_starts[line]) };
+}
@@ -0,0 +1,105 @@
+// compiler-token-stream.h: 紧凑词元流，按结构数组存储词元
+
+#pragma once
+
+#include "compiler-base.h"
+
+namespace compiler
+{
+	struct token_stream;
+
+	// 词元视图：从词元流中按需解出的单个词元，行列位置仅在报错时计算
+	struct token_view : public token_base
+	{
+		std::string_view literal;
+
+		const token_stream* stream = nullptr;
+		size_t index = 0;
+
+	public:
+		// 提取负数
+		number_union get_negative_val() const;
+
+		// 行列位置
+		std::pair<size_t, size_t> position() const;
+	};
+
+	// 词元流：类别字节、细分类别字节、32位源码偏移与载荷分别存放
+	// 每个词元占10字节，不拥有字面量，源码与符号驻留表须在词元流使用期间保持有效
+	struct token_stream
+	{
+		static constexpr uint8_t white_space_flag = 0x80; // 类别字节最高位：词元后是否紧跟空白
+
+		std::string_view source; // 源码
+		const symbol_interner* symbols = nullptr; // 标识符名称
+
+		std::vector<uint8_t> types; // 大类别 | 空白标志
+		std::vector<uint8_t> subtypes; // 细分类别
+		std::vector<uint32_t> offsets; // 源码偏移
+		std::vector<uint32_t> payloads; // 常量：数据位；标识符：符号编号；关键词/数据类型：字面量长度
+		std::vector<uint32_t> line_starts{ 0 }; // 行首偏移表
+		bracket_table brackets; // 括号匹配表
+
+	public:
+		token_stream() = default;
+		token_stream(std::string_view source, const symbol_interner& symbols) : source(source), symbols(&symbols) {}
+
+		inline size_t size() const { return types.size(); }
+
+		// 追加词元；literal_length 仅用于关键词与数据类型
+		void push_back(const token_base& t, uint32_t offset, uint32_t literal_length);
+
+		// 取词元视图，越界时抛出 std::out_of_range，与 token_list::at 行为一致
+		token_view at(size_t index) const;
+
+		// 计算行列位置：在行首表中二分查找
+		std::pair<size_t, size_t> position(size_t index) const;
+	};
+
+	inline token_view token_stream::at(size_t index) const
+	{
+		if (index >= size()) throw std::out_of_range("Token index out of range.");
+
+		token_view view;
+		const uint8_t type_byte = types[index];
+
+		view.type = token_type(type_byte & ~white_space_flag);
+		view.white_space = (type_byte & white_space_flag) != 0;
+		view.stream = this;
+		view.index = index;
+
+		switch (view.type)
+		{
+		case token_type::keyword:
+			view.key_type = keyword_type(subtypes[index]);
+			view.literal = source.substr(offsets[index], payloads[index]);
+			break;
+
+		case token_type::number_type:
+			view.number_type = number_type(subtypes[index]);
+			view.literal = source.substr(offsets[index], payloads[index]);
+			break;
+
+		case token_type::identifier:
+			view.symbol = payloads[index];
+			view.literal = symbols->names[view.symbol];
+			break;
+
+		case token_type::number:
+			view.number_type = number_type(subtypes[index]);
+			view.number_data.uint_number = payloads[index];
+			break;
+
+		default:
+			view.op_type = operand_type(subtypes[index]);
+			break;
+		}
+
+		return view;
+	}
+
+	inline std::pair<size_t, size_t> token_view::position() const
+	{
+		return stream->position(index);
+	}
+}
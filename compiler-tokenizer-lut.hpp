@@ -0,0 +1,439 @@
+// compiler-tokenizer-lut.hpp: 词法分析器所用字符分类表与SIMD扫描函数
+
+#pragma once
+
+#include "compiler-base.h"
+#include "compiler-unicode-xid.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#define EZ_TOKENIZER_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EZ_TOKENIZER_SSE2
+#endif
+
+#if defined(EZ_TOKENIZER_AVX2) || defined(EZ_TOKENIZER_SSE2)
+#include <immintrin.h>
+#endif
+
+namespace compiler::tokenizer_lut
+{
+	// 字符类别（按位组合）
+	enum char_class : uint8_t
+	{
+		cc_none = 0,
+		cc_white_space = 1 << 0, // 空白字符：' ', '\t', '\r', '\n'
+		cc_new_line = 1 << 1, // 换行符
+		cc_identifier_start = 1 << 2, // 标识符首字符
+		cc_identifier = 1 << 3, // 标识符后续字符
+		cc_number_start = 1 << 4, // 数字常量首字符
+		cc_operator = 1 << 5 // 运算符/语块符
+	};
+
+	// 运算符表项
+	struct operator_entry
+	{
+		token_type type = token_type::unknown;
+		operand_type op_type = operand_type::none;
+
+		// 可组成双字符运算符的后继字符，双字符运算符均为双目运算
+		char follow[2] = { 0, 0 };
+		operand_type follow_op[2] = { operand_type::none, operand_type::none };
+	};
+
+	// 256项字符分类表
+	constexpr std::array<uint8_t, 256> char_class_lut = []
+	{
+		std::array<uint8_t, 256> lut{};
+
+		for (int c = 'A'; c <= 'Z'; c++) lut[c] |= cc_identifier_start | cc_identifier;
+		for (int c = 'a'; c <= 'z'; c++) lut[c] |= cc_identifier_start | cc_identifier;
+		for (int c = '0'; c <= '9'; c++) lut[c] |= cc_identifier | cc_number_start;
+
+		lut['_'] |= cc_identifier_start | cc_identifier;
+		lut['.'] |= cc_number_start;
+
+		lut[' '] |= cc_white_space;
+		lut['\t'] |= cc_white_space;
+		lut['\r'] |= cc_white_space;
+		lut['\n'] |= cc_white_space | cc_new_line;
+
+		for (char c : std::string_view{ ";,{}()+-*/%!|&^@:=<>" }) lut[uint8_t(c)] |= cc_operator;
+
+		return lut;
+	}();
+
+	// 256项运算符表
+	constexpr std::array<operator_entry, 256> operator_lut = []
+	{
+		std::array<operator_entry, 256> lut{};
+
+		auto set = [&lut](char c, token_type type, operand_type op = operand_type::none) -> operator_entry&
+		{
+			auto& entry = lut[uint8_t(c)];
+			entry.type = type;
+			entry.op_type = op;
+			return entry;
+		};
+
+		set(';', token_type::semicolon);
+		set(',', token_type::separator);
+		set('{', token_type::left_bracket);
+		set('}', token_type::right_bracket);
+		set('(', token_type::left_parentheses);
+		set(')', token_type::right_parentheses);
+
+		set('+', token_type::double_operand, operand_type::add);
+		set('-', token_type::double_operand, operand_type::sub);
+		set('*', token_type::double_operand, operand_type::mul);
+		set('/', token_type::double_operand, operand_type::div);
+		set('%', token_type::double_operand, operand_type::mod);
+		set('|', token_type::double_operand, operand_type::bit_or);
+		set('&', token_type::double_operand, operand_type::bit_and);
+		set('^', token_type::double_operand, operand_type::bit_xor);
+		set('@', token_type::single_operand, operand_type::get_address);
+		set(':', token_type::single_operand, operand_type::explanation);
+
+		auto& not_entry = set('!', token_type::single_operand, operand_type::bit_not);
+		not_entry.follow[0] = '='; not_entry.follow_op[0] = operand_type::not_equal;
+
+		auto& set_entry = set('=', token_type::double_operand, operand_type::set_val);
+		set_entry.follow[0] = '='; set_entry.follow_op[0] = operand_type::equal;
+
+		auto& smaller_entry = set('<', token_type::double_operand, operand_type::smaller);
+		smaller_entry.follow[0] = '='; smaller_entry.follow_op[0] = operand_type::smaller_or_equal;
+		smaller_entry.follow[1] = '<'; smaller_entry.follow_op[1] = operand_type::bit_lsh;
+
+		auto& larger_entry = set('>', token_type::double_operand, operand_type::larger);
+		larger_entry.follow[0] = '='; larger_entry.follow_op[0] = operand_type::larger_or_equal;
+		larger_entry.follow[1] = '>'; larger_entry.follow_op[1] = operand_type::bit_rsh;
+
+		return lut;
+	}();
+
+	// 单词分类结果：关键词/数据类型/普通标识符
+	struct word_entry
+	{
+		token_type type = token_type::identifier;
+		keyword_type key_type = keyword_type::none;
+		number_type val_type = number_type::none;
+	};
+
+	// 单词分类：先按长度与首字符分支，再做一次比较，无分配、无哈希
+	constexpr word_entry classify_word(std::string_view word)
+	{
+		constexpr auto keyword = [](keyword_type type) { return word_entry{ token_type::keyword, type, number_type::none }; };
+		constexpr auto data_type = [](number_type type) { return word_entry{ token_type::number_type, keyword_type::none, type }; };
+
+		switch (word.length())
+		{
+		case 2:
+			if (word == "if") return keyword(keyword_type::kw_if);
+			break;
+
+		case 3:
+			if (word[0] == 'f' && word == "for") return keyword(keyword_type::kw_for);
+			if (word[0] == 'i' && word == "int") return data_type(number_type::integer);
+			break;
+
+		case 4:
+			if (word[0] == 'e' && word == "else") return keyword(keyword_type::kw_else);
+			if (word[0] == 'f' && word == "func") return keyword(keyword_type::kw_func);
+			if (word[0] == 'u' && word == "uint") return data_type(number_type::unsigned_integer);
+			break;
+
+		case 5:
+			if (word[0] == 'w' && word == "while") return keyword(keyword_type::kw_while);
+			if (word[0] == 'b' && word == "break") return keyword(keyword_type::kw_break);
+			if (word[0] == 'f' && word == "float") return data_type(number_type::float_point);
+			break;
+
+		case 6:
+			if (word == "return") return keyword(keyword_type::kw_return);
+			break;
+
+		case 8:
+			if (word == "continue") return keyword(keyword_type::kw_continue);
+			break;
+		}
+
+		return word_entry{};
+	}
+
+	static_assert(classify_word("while").key_type == keyword_type::kw_while);
+	static_assert(classify_word("else").key_type == keyword_type::kw_else);
+	static_assert(classify_word("uint").val_type == number_type::unsigned_integer);
+	static_assert(classify_word("float").val_type == number_type::float_point);
+	static_assert(classify_word("fort").type == token_type::identifier);
+	static_assert(classify_word("If").type == token_type::identifier);
+
+	inline bool has_class(char c, uint8_t cls)
+	{
+		return (char_class_lut[uint8_t(c)] & cls) != 0;
+	}
+
+#if defined(EZ_TOKENIZER_SSE2)
+	// 16字节中的标识符字符掩码：[A-Za-z0-9_]
+	inline uint32_t identifier_mask(__m128i v)
+	{
+		const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+		const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+		const __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+		return uint32_t(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under)));
+	}
+
+	// 16字节中的空白字符掩码
+	inline uint32_t white_space_mask(__m128i v, uint32_t& new_line)
+	{
+		const __m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+		const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), nl));
+		new_line = uint32_t(_mm_movemask_epi8(nl));
+		return uint32_t(_mm_movemask_epi8(ws));
+	}
+#endif
+
+#if defined(EZ_TOKENIZER_AVX2)
+	// 32字节中的标识符字符掩码
+	inline uint32_t identifier_mask(__m256i v)
+	{
+		const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		const __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+		const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+		const __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+		return uint32_t(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under)));
+	}
+
+	// 32字节中的空白字符掩码
+	inline uint32_t white_space_mask(__m256i v, uint32_t& new_line)
+	{
+		const __m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+		const __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), nl));
+		new_line = uint32_t(_mm256_movemask_epi8(nl));
+		return uint32_t(_mm256_movemask_epi8(ws));
+	}
+#endif
+
+	// 跳过标识符字符，返回首个非标识符字符位置
+	inline const char* skip_identifier(const char* iter, const char* end)
+	{
+#if defined(EZ_TOKENIZER_AVX2)
+		while (end - iter >= 32)
+		{
+			const uint32_t mask = identifier_mask(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(iter)));
+			if (mask != 0xFFFFFFFFu) return iter + std::countr_one(mask);
+			iter += 32;
+		}
+#endif
+#if defined(EZ_TOKENIZER_SSE2)
+		while (end - iter >= 16)
+		{
+			const uint32_t mask = identifier_mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(iter)));
+			if (mask != 0xFFFFu) return iter + std::countr_one(mask);
+			iter += 16;
+		}
+#endif
+		while (iter != end && has_class(*iter, cc_identifier)) iter++;
+		return iter;
+	}
+
+	// 解码一个多字节 UTF-8 字符并前移 iter，非法序列（截断、超长编码、代理区、超出 U+10FFFF）返回 -1 且不移动
+	inline int32_t decode_utf8(const char*& iter, const char* end)
+	{
+		const uint8_t lead = uint8_t(*iter);
+		size_t length;
+		uint32_t code, min;
+
+		if (lead >= 0xC2 && lead <= 0xDF) { length = 2; code = lead & 0x1F; min = 0x80; }
+		else if (lead >= 0xE0 && lead <= 0xEF) { length = 3; code = lead & 0x0F; min = 0x800; }
+		else if (lead >= 0xF0 && lead <= 0xF4) { length = 4; code = lead & 0x07; min = 0x10000; }
+		else return -1;
+
+		if (size_t(end - iter) < length) return -1;
+
+		for (size_t i = 1; i < length; i++)
+		{
+			const uint8_t c = uint8_t(iter[i]);
+			if ((c & 0xC0) != 0x80) return -1;
+			code = (code << 6) | (c & 0x3F);
+		}
+
+		if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) return -1;
+
+		iter += length;
+		return int32_t(code);
+	}
+
+	// 查找首个非法 UTF-8 字节，合法时返回 end
+	// 纯 ASCII 数据块由 SIMD 整块跳过，仅含非 ASCII 字节的位置逐字符解码
+	inline const char* find_invalid_utf8(const char* iter, const char* end)
+	{
+		while (iter != end)
+		{
+#if defined(EZ_TOKENIZER_AVX2)
+			while (end - iter >= 32)
+			{
+				const uint32_t mask = uint32_t(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(iter))));
+				if (mask) { iter += std::countr_zero(mask); break; }
+				iter += 32;
+			}
+#endif
+#if defined(EZ_TOKENIZER_SSE2)
+			while (end - iter >= 16)
+			{
+				const uint32_t mask = uint32_t(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(iter))));
+				if (mask) { iter += std::countr_zero(mask); break; }
+				iter += 16;
+			}
+#endif
+			while (iter != end && uint8_t(*iter) < 0x80) iter++;
+			if (iter == end) break;
+
+			if (decode_utf8(iter, end) < 0) return iter;
+		}
+
+		return end;
+	}
+
+	// 在区间表中二分查找
+	template<size_t count>
+	inline bool in_ranges(const unicode_xid::code_range (&ranges)[count], int32_t code)
+	{
+		auto found = std::upper_bound(ranges, ranges + count, uint32_t(code), [](uint32_t c, const unicode_xid::code_range& r) { return c < r.first; });
+		return found != ranges && uint32_t(code) <= (found - 1)->last;
+	}
+
+	inline bool is_xid_start(int32_t code) { return in_ranges(unicode_xid::xid_start, code); }
+	inline bool is_xid_continue(int32_t code) { return in_ranges(unicode_xid::xid_continue, code); }
+
+	// 跳过标识符后续字符（含非 ASCII 的 XID_Continue 字符），返回首个非标识符字符位置
+	// 非法 UTF-8 序列使标识符在此结束，由下一个词元报错
+	inline const char* skip_unicode_identifier(const char* iter, const char* end)
+	{
+		iter = skip_identifier(iter, end);
+
+		while (iter != end && uint8_t(*iter) >= 0x80)
+		{
+			const char* next = iter;
+			const int32_t code = decode_utf8(next, end);
+			if (code < 0 || !is_xid_continue(code)) break;
+
+			iter = skip_identifier(next, end);
+		}
+
+		return iter;
+	}
+
+	// 行号追踪：仅记录当前行号与行首
+	struct line_counter
+	{
+		size_t line = 0;
+		const char* line_begin;
+
+	public:
+		line_counter(const char* begin) : line_begin(begin) {}
+
+		// 单个换行符
+		inline void add(const char* new_line)
+		{
+			line++;
+			line_begin = new_line + 1;
+		}
+
+		// 一个数据块中的换行符掩码
+		inline void add_mask(const char* block, uint32_t mask)
+		{
+			if (mask == 0) return;
+			line += std::popcount(mask);
+			line_begin = block + (31 - std::countl_zero(mask)) + 1;
+		}
+
+		inline std::pair<size_t, size_t> position(const char* iter) const
+		{
+			return { line, size_t(iter - line_begin) };
+		}
+	};
+
+	// 行首表：记录每一行的起始偏移，供词元流按需计算行列
+	struct line_table
+	{
+		const char* source;
+		std::vector<uint32_t>& line_starts;
+
+	public:
+		line_table(const char* source, std::vector<uint32_t>& line_starts) : source(source), line_starts(line_starts) {}
+
+		inline void add(const char* new_line)
+		{
+			line_starts.push_back(uint32_t(new_line + 1 - source));
+		}
+
+		inline void add_mask(const char* block, uint32_t mask)
+		{
+			for (; mask != 0; mask &= mask - 1)
+				add(block + std::countr_zero(mask));
+		}
+
+		inline std::pair<size_t, size_t> position(const char* iter) const
+		{
+			return { line_starts.size() - 1, size_t(iter - source) - line_starts.back() };
+		}
+	};
+
+	// 跳过空白字符，返回首个非空白字符位置，同时记录其中的换行
+	template<class line_tracker>
+	inline const char* skip_white_space(const char* iter, const char* end, line_tracker& lines)
+	{
+		// 绝大多数词元之间至多一个空白字符，先做标量检查
+		if (iter == end || !has_class(*iter, cc_white_space)) return iter;
+
+#if defined(EZ_TOKENIZER_AVX2)
+		while (end - iter >= 32)
+		{
+			uint32_t new_line;
+			const uint32_t mask = white_space_mask(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(iter)), new_line);
+			const int run = std::countr_one(mask);
+
+			if (run < 32)
+			{
+				lines.add_mask(iter, new_line & ((1u << run) - 1));
+				return iter + run;
+			}
+
+			lines.add_mask(iter, new_line);
+			iter += 32;
+		}
+#endif
+#if defined(EZ_TOKENIZER_SSE2)
+		while (end - iter >= 16)
+		{
+			uint32_t new_line;
+			const uint32_t mask = white_space_mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(iter)), new_line);
+			const int run = std::countr_one(mask);
+
+			if (run < 16)
+			{
+				lines.add_mask(iter, new_line & ((1u << run) - 1));
+				return iter + run;
+			}
+
+			lines.add_mask(iter, new_line);
+			iter += 16;
+		}
+#endif
+		while (iter != end && has_class(*iter, cc_white_space))
+		{
+			if (*iter == '\n') lines.add(iter);
+			iter++;
+		}
+
+		return iter;
+	}
+}
@@ -1,345 +1,498 @@
 // compiler-tokenizer.cpp: 实现词法分析器
 
 #include "compiler-tokenizer.h"
-#include "compiler-tokenizer-regex.hpp"
+#include "compiler-tokenizer-lut.hpp"
 
 using namespace compiler;
+using namespace compiler::tokenizer_lut;
+
+// 十进制数字
+static constexpr bool is_dec_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// 十六进制数字
+static constexpr bool is_hex_digit(char c)
+{
+    return is_dec_digit(c) || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
 
 std::optional<std::tuple<number_union, size_t, number_type>> compiler::tokenizer::get_number(std::string_view input)
 {
-    // 确定长度；若std::string_view可于std::regex_match中使用，则去除
+    // 确定长度：候选字符集与旧版正则实现保持一致
     size_t len = 0;
-    while ((input[len] >= '0' && input[len] <= '9')
-        || (input[len] == 'x' && len == 1) 
-        || input[len] == 'u' 
-        || input[len] == '.' 
-        || input[len] == 'f' 
-        || (input[len] == '-' && len == 0))
+    while (len < input.length())
     {
-        len++;
-        if (len >= input.length()) break;
+        const char c = input[len];
+
+        if (is_dec_digit(c)
+            || (c == 'x' && len == 1)
+            || c == 'u'
+            || c == '.'
+            || c == 'f'
+            || (c == '-' && len == 0))
+        {
+            len++;
+            continue;
+        }
+
+        break;
     }
 
-    std::string number_string{input.substr(0, len)}; // 拷贝字符串，导致性能损失
+    if (len == 0) return std::nullopt;
 
+    // 单次遍历确定格式，直接在视图上转换，不拷贝字符串
+    const char* first = input.data();
+    const char* last = first + len;
     number_union ret;
 
-    if (std::regex_match(number_string, hex_regex)) // 十六进制
+    if (len > 2 && first[0] == '0' && first[1] == 'x') // 十六进制：0x[0-9A-Fa-f]+
     {
-        std::string match = std::regex_replace(number_string, hex_regex, "$1");
-        ret.uint_number = strtoul(match.c_str(), nullptr, 16);
+        if (!std::all_of(first + 2, last, is_hex_digit)) return std::nullopt;
+
+        if (std::from_chars(first + 2, last, ret.uint_number, 16).ec == std::errc::result_out_of_range)
+            ret.uint_number = std::numeric_limits<unsigned int>::max(); // 与strtoul一致：溢出时饱和
+
         return std::tuple(ret, len, number_type::unsigned_integer);
     }
 
-    if (std::regex_match(number_string, unsigned_dec_regex)) // 无符号整数，32位
+    // 统计整数部分、小数点与小数部分
+    const char* iter = first;
+    while (iter != last && is_dec_digit(*iter)) iter++;
+    const char* int_end = iter;
+
+    if (iter == last) // 有符号整数，32位：[0-9]+
     {
-        std::string match = std::regex_replace(number_string, unsigned_dec_regex, "$1");
-        ret.uint_number = strtoul(match.c_str(), nullptr, 10);
-        return std::tuple(ret, len, number_type::unsigned_integer);
+        if (std::from_chars(first, last, ret.int_number, 10).ec == std::errc::result_out_of_range)
+            ret.int_number = std::numeric_limits<int>::max(); // 与atoi一致：溢出时饱和
+
+        return std::tuple(ret, len, number_type::integer);
     }
 
-    if (std::regex_match(number_string, float_regex)) // 单精度浮点数
+    if (*iter == 'u' && iter + 1 == last && iter != first) // 无符号整数，32位：[0-9]+u
     {
-        std::string match = std::regex_replace(number_string, float_regex, "$1");
-        ret.fp_number = strtof(match.c_str(), nullptr);
-        return std::tuple(ret, len, number_type::float_point);
+        if (std::from_chars(first, iter, ret.uint_number, 10).ec == std::errc::result_out_of_range)
+            ret.uint_number = std::numeric_limits<unsigned int>::max();
+
+        return std::tuple(ret, len, number_type::unsigned_integer);
     }
 
-    if (std::regex_match(number_string, signed_dec_regex)) // 有符号整数，32位
+    if (*iter == '.') // 单精度浮点数：[0-9]*\.[0-9]+f?
     {
-        std::string match = std::regex_replace(number_string, signed_dec_regex, "$1");
-        ret.int_number = atoi(match.c_str());
-        return std::tuple(ret, len, number_type::integer);
+        iter++;
+        const char* frac_begin = iter;
+        while (iter != last && is_dec_digit(*iter)) iter++;
+        const char* frac_end = iter;
+
+        if (frac_end == frac_begin) return std::nullopt; // 小数部分不可为空
+        if (iter != last && *iter == 'f') iter++;
+        if (iter != last) return std::nullopt;
+
+        auto [ptr, ec] = std::from_chars(first, frac_end, ret.fp_number, std::chars_format::fixed);
+        if (ec == std::errc::result_out_of_range) // 与strtof一致：上溢为无穷，下溢为0
+            ret.fp_number = std::any_of(first, int_end, [](char c) { return c != '0'; })
+                ? std::numeric_limits<float>::infinity() : 0.0f;
+
+        return std::tuple(ret, len, number_type::float_point);
     }
 
     return std::nullopt; // 无对应
 }
 
-std::optional<std::string_view> compiler::tokenizer::get_identifier(std::string_view input)
+template<class line_tracker>
+bool compiler::tokenizer::scan_token(const char*& iter, const char* end, line_tracker& lines, token_base& t, const char*& begin)
 {
-    // 空字符串检测
-    if (input.length() == 0) return std::nullopt;
+    // 空字符处理
+    iter = skip_white_space(iter, end, lines);
+    if (iter == end) return false;
+
+    begin = iter;
+    const uint8_t cls = char_class_lut[uint8_t(*iter)];
 
-    // 首字符检测
-    if (!((input[0] >= 'A' && input[0] <= 'Z')
-        || (input[0] >= 'a' && input[0] <= 'z')
-        || input[0] == '_'))
+    // 标识符解析
+    if (cls & cc_identifier_start)
     {
-        return std::nullopt;
+        iter = skip_unicode_identifier(iter + 1, end);
+
+        // 解析关键词/数据类型
+        const auto word = classify_word(std::string_view(begin, iter - begin));
+        t.type = word.type;
+
+        if (word.type == token_type::keyword)
+            t.key_type = word.key_type;
+        else if (word.type == token_type::number_type)
+            t.number_type = word.val_type;
+
+        t.white_space = iter != end && has_class(*iter, cc_white_space); // 空格
+        return true;
     }
 
-    // 确定长度
-    size_t iter = 1;
-    while (1)
+    // 解析数字
+    if (cls & cc_number_start)
     {
-        if (iter >= input.length())
-            break;
-
-        if (!((input[iter] >= 'A' && input[iter] <= 'Z')
-            || (input[iter] >= 'a' && input[iter] <= 'z')
-            || input[iter] == '_'
-            || (input[iter] >= '0' && input[iter] <= '9')))
+        auto number_parse_obj = get_number(std::string_view(iter, end - iter));
+        if (number_parse_obj)
         {
-            break; // 不符合条件，跳出
+            t.type = token_type::number;
+            t.number_data = std::get<0>(number_parse_obj.value()); // 常量本体
+            t.number_type = std::get<2>(number_parse_obj.value()); // 数据类型
+
+            iter += std::get<1>(number_parse_obj.value()); // 长度
+            t.white_space = iter != end && has_class(*iter, cc_white_space);
+            return true;
         }
+    }
+
+    // 处理算术符和语块符
+    if (cls & cc_operator)
+    {
+        const auto& entry = operator_lut[uint8_t(*iter)];
 
+        t.type = entry.type;
+        t.op_type = entry.op_type;
         iter++;
 
-        if (iter >= input.length()) break;
+        // 双字符运算符
+        if (iter != end && entry.follow[0] != 0)
+        {
+            for (size_t i = 0; i < 2; i++)
+                if (*iter == entry.follow[i])
+                {
+                    t.type = token_type::double_operand;
+                    t.op_type = entry.follow_op[i];
+                    iter++;
+                    break;
+                }
+        }
+
+        t.white_space = iter != end && has_class(*iter, cc_white_space);
+        return true;
     }
 
-    return input.substr(0, iter); // 截取字符串
-}
+    // 非 ASCII 字符：只可能是 Unicode 标识符
+    if (uint8_t(*iter) >= 0x80)
+    {
+        const char* next = iter;
+        const int32_t code = decode_utf8(next, end);
 
-bool compiler::tokenizer::has_white_space(std::string_view view)
-{
-    if (view.length() > 0)
-        if (view[0] == ' ' || view[0] == '\r' || view[0] == '\n' || view[0] == '\t')
+        if (code < 0)
+        {
+            auto [line, character] = lines.position(iter);
+            throw tokenizer_exception(line, character, "Invalid UTF-8 sequence.");
+        }
+
+        if (is_xid_start(code))
+        {
+            iter = skip_unicode_identifier(next, end);
+
+            t.type = token_type::identifier; // 非 ASCII 标识符不可能是关键词
+            t.white_space = iter != end && has_class(*iter, cc_white_space);
             return true;
-    return false;
+        }
+    }
+
+    // 无匹配运算符
+    auto [line, character] = lines.position(iter);
+    throw tokenizer_exception(line, character, "Unable to parse this token.");
 }
 
-const std::unordered_map<std::string, keyword_type> compiler::keyword_lut = 
+void compiler::tokenizer::validate_utf8(std::string_view str)
 {
-    {"while", keyword_type::kw_while},
-    {"if", keyword_type::kw_if},
-    {"func", keyword_type::kw_func},
-    {"return", keyword_type::kw_return},
-    {"for", keyword_type::kw_for},
-    {"break", keyword_type::kw_break},
-    {"continue", keyword_type::kw_continue},
-    {"else", keyword_type::kw_else}
-};
-
-const std::unordered_map<std::string, number_type> compiler::number_type_lut =
+    const char* const begin = str.data();
+    const char* const end = begin + str.length();
+    const char* invalid = find_invalid_utf8(begin, end);
+
+    if (invalid == end) return;
+
+    // 仅在出错时计算行列
+    line_counter lines(begin);
+    for (const char* iter = begin; iter != invalid; iter++)
+        if (*iter == '\n') lines.add(iter);
+
+    auto [line, character] = lines.position(invalid);
+    throw tokenizer_exception(line, character, "Invalid UTF-8 sequence.");
+}
+
+size_t compiler::tokenizer::tokenize_into(std::string_view str, symbol_interner& symbols, std::vector<token>& list)
 {
-    {"int", number_type::integer},
-    {"uint", number_type::unsigned_integer},
-    {"float", number_type::float_point}
-};
+    const char* iter = str.data();
+    const char* const end = iter + str.length();
+    const char* begin = iter;
+    line_counter lines(iter);
 
-std::vector<token> compiler::tokenizer::tokenize(std::string_view str)
+    token t;
+    while (scan_token(iter, end, lines, t, begin))
+    {
+        std::tie(t.line, t.character) = lines.position(begin);
+
+        if (t.type == token_type::identifier || t.type == token_type::keyword || t.type == token_type::number_type)
+            t.literal = std::string_view(begin, iter - begin);
+
+        if (t.type == token_type::identifier)
+            t.symbol = symbols.intern(t.literal);
+
+        list.push_back(std::move(t));
+        t = token();
+    }
+
+    return lines.line;
+}
+
+std::vector<token> compiler::tokenizer::tokenize(std::string_view str, symbol_interner& symbols)
 {
+    const size_t threads = std::thread::hardware_concurrency();
+
+    if (str.length() >= parallel_threshold && threads > 1)
+        return tokenize_parallel(str, symbols, threads);
+
+    validate_utf8(str);
+
     std::vector<token> list;
-    std::string_view view{str};
-    size_t line = 0, character = 0;
+    list.reserve(str.length() / 8); // 预估词元数量，避免大文件反复扩容搬移词元
 
-    while (view.length() > 0)
-    {
-        // 空字符处理
-        switch (view[0])
-        {
-        case ' ':
-        case '\r':
-        case '\t':
-            view = view.substr(1);
-            character++;
-            continue;
-        case '\n':
-            view = view.substr(1);
-            line++; character = 0;
-            continue;
-        }
+    tokenize_into(str, symbols, list);
 
-        token t;
-        t.line = line; t.character = character;
+    return list;
+}
 
-        // 标识符解析
-        auto identifier_str = get_identifier(view);
-        if (identifier_str)
-        {
-            auto result = identifier_str.value();
-            view = view.substr(result.length());
-            character += result.length();
-            t.literal = result;
+std::vector<token> compiler::tokenizer::tokenize(std::string_view str, symbol_interner& symbols, bracket_table& brackets)
+{
+    auto list = tokenize(str, symbols);
 
-            // 解析关键词
-            auto kw_search = keyword_lut.find(std::string(result));
-            auto nt_search = number_type_lut.find(std::string(result));
+    // 并行分段扫描的括号可能跨段配对，拼接完成后统一记录
+    brackets.match.reserve(list.size());
+    for (const auto& t : list) brackets.push(t.type);
 
-            if (kw_search != keyword_lut.end())
-            {
-                t.type = token_type::keyword;
-                t.key_type = kw_search->second;
-            }
-            else if (nt_search != number_type_lut.end())
-            {
-                t.type = token_type::number_type;
-                t.number_type = nt_search->second;
-            }
-            else // 普通标识符
-            {
-                t.type = token_type::identifier;
-            }
+    return list;
+}
 
-            t.white_space = has_white_space(view); // 空格
+// 在 count 个线程上执行 func(0..count-1)，第0项在调用线程上执行
+template<class func_type>
+static void run_parallel(size_t count, const func_type& func)
+{
+    std::vector<std::thread> workers;
+    workers.reserve(count);
 
-            list.push_back(t);
-            continue;
-        }
+    for (size_t i = 1; i < count; i++)
+        workers.emplace_back(func, i);
 
-        // 解析数字
-        auto number_parse_obj = get_number(view);
-        if (number_parse_obj)
-        {
-            t.type = token_type::number;
-            t.number_data = std::get<0>(number_parse_obj.value()); // 常量本体
-            t.number_type = std::get<2>(number_parse_obj.value()); // 数据类型
+    if (count) func(0);
 
-            size_t len = std::get<1>(number_parse_obj.value());
-            view = view.substr(len); // 长度
-            t.white_space = has_white_space(view);
-            character += len;
+    for (auto& worker : workers) worker.join();
+}
 
-            list.push_back(t);
-            continue;
-        }
+std::vector<token> compiler::tokenizer::tokenize_parallel(std::string_view str, symbol_interner& symbols, size_t chunk_count)
+{
+    // 与单线程一致：先整体校验 UTF-8，再扫描词元
+    validate_utf8(str);
+
+    // 切分：语言中没有跨行的词元，每段在换行符之后结束，段首即行首
+    std::vector<std::string_view> chunks;
+    const size_t target = std::max<size_t>(str.length() / std::max<size_t>(chunk_count, 1), 1);
 
-        size_t view_seek = 1;
+    for (size_t begin = 0; begin < str.length();)
+    {
+        size_t split = std::min(begin + target, str.length());
 
-        // 处理算术符和语块符
-        switch (view[0])
+        if (split < str.length())
         {
-        case ';':
-            t.type = token_type::semicolon;
-            break;
-        case ',':
-            t.type = token_type::separator;
-            break;
-        case '{':
-            t.type = token_type::left_bracket;
-            break;
-        case '}':
-            t.type = token_type::right_bracket;
-            break;
-        case '(':
-            t.type = token_type::left_parentheses;
-            break;
-        case ')':
-            t.type = token_type::right_parentheses;
-            break;
-        case '+':
-            t.type = token_type::double_operand;
-            t.op_type = operand_type::add;
-            break;
-        case '-':
-            t.type = token_type::double_operand;
-            t.op_type = operand_type::sub;
-            break;
-        case '*':
-            t.type = token_type::double_operand;
-            t.op_type = operand_type::mul;
-            break;
-        case '/':
-            t.type = token_type::double_operand;
-            t.op_type = operand_type::div;
-            break;
-        case '%':
-            t.type = token_type::double_operand;
-            t.op_type = operand_type::mod;
-            break;
-        case '!':
-            if (view[1] == '=')
-            {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::not_equal;
+            const size_t new_line = str.find('\n', split - 1);
+            split = new_line == std::string_view::npos ? str.length() : new_line + 1;
+        }
 
-                view_seek = 2;
-            }
-            else
-            {
-                t.type = token_type::single_operand;
-                t.op_type = operand_type::bit_not;
-            }
-            break;
-        case '|':
-            t.type = token_type::double_operand;
-            t.op_type = operand_type::bit_or;
-            break;
-        case '&':
-            t.type = token_type::double_operand;
-            t.op_type = operand_type::bit_and;
-            break;
-        case '^':
-            t.type = token_type::double_operand;
-            t.op_type = operand_type::bit_xor;
-            break;
-        case '@':
-            t.type = token_type::single_operand;
-            t.op_type = operand_type::get_address;
-            break;
-        case ':':
-            t.type = token_type::single_operand;
-            t.op_type = operand_type::explanation;
-            break;
-        case '=':
-            if (view[1] == '=')
-            {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::equal;
+        chunks.push_back(str.substr(begin, split - begin));
+        begin = split;
+    }
 
-                view_seek = 2;
-            }
-            else
-            {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::set_val;
-            }
-            break;
-        case '<':
-            if (view[1] == '=')
-            {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::smaller_or_equal;
-                view_seek = 2;
-            }
-            else if (view[1] == '<')
-            {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::bit_lsh;
-                view_seek = 2;
-            }
-            else
+    // 各段独立扫描：行号从0开始，标识符驻留于段内的符号表
+    struct chunk_result
+    {
+        std::vector<token> list;
+        symbol_interner symbols;
+        size_t lines = 0;
+        std::exception_ptr error;
+    };
+
+    std::vector<chunk_result> results(chunks.size());
+
+    run_parallel(chunks.size(), [&](size_t i)
+        {
+            try
             {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::smaller;
+                results[i].list.reserve(chunks[i].length() / 8);
+                results[i].lines = tokenize_into(chunks[i], results[i].symbols, results[i].list);
             }
-            break;
-        case '>':
-            if (view[1] == '=')
+            catch (...)
             {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::larger_or_equal;
-                view_seek = 2;
+                results[i].error = std::current_exception();
             }
-            else if (view[1] == '>')
+        });
+
+    // 按段顺序汇总：行号偏移、词元偏移，并按段顺序驻留段内符号，使编号与单线程首次出现顺序一致
+    std::vector<size_t> line_offsets(chunks.size()), token_offsets(chunks.size());
+    std::vector<std::vector<symbol_id>> remaps(chunks.size());
+    size_t line_offset = 0, token_count = 0;
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        // 输入已整体校验，各段只可能有词法错误，最靠前者即单线程扫描会遇到的错误
+        if (results[i].error)
+        {
+            try
             {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::bit_rsh;
-                view_seek = 2;
+                std::rethrow_exception(results[i].error);
             }
-            else
+            catch (tokenizer_exception& e)
             {
-                t.type = token_type::double_operand;
-                t.op_type = operand_type::larger;
+                e.line += line_offset;
+                throw;
             }
-            break;
         }
 
-        // 运算符处理
-        if (t.type != token_type::unknown)
-        {
-            view = view.substr(view_seek);
-            t.white_space = has_white_space(view);
-            character += view_seek;
-            list.push_back(t);
-            continue;
-        }
-        else // 无匹配运算符
-        {
-            throw tokenizer_exception(line, character, "Unable to parse this token.");
-        }
+        line_offsets[i] = line_offset;
+        token_offsets[i] = token_count;
+        line_offset += results[i].lines;
+        token_count += results[i].list.size();
+
+        remaps[i].reserve(results[i].symbols.size());
+        for (auto name : results[i].symbols.names)
+            remaps[i].push_back(symbols.intern(name));
     }
 
+    // 拼接：修正行号与符号编号
+    std::vector<token> list(token_count);
+
+    run_parallel(chunks.size(), [&](size_t i)
+        {
+            auto dst = list.begin() + token_offsets[i];
+
+            for (auto& t : results[i].list)
+            {
+                t.line += line_offsets[i];
+                if (t.type == token_type::identifier) t.symbol = remaps[i][t.symbol];
+
+                *dst++ = t;
+            }
+        });
+
     return list;
 }
+
+token_stream compiler::tokenizer::tokenize_stream(std::string_view str, symbol_interner& symbols)
+{
+    if (str.length() > std::numeric_limits<uint32_t>::max())
+        throw tokenizer_exception("Source is too large for a token stream (32-bit offsets).");
+
+    validate_utf8(str);
+
+    token_stream stream(str, symbols);
+
+    const size_t estimate = str.length() / 8;
+    stream.types.reserve(estimate);
+    stream.subtypes.reserve(estimate);
+    stream.offsets.reserve(estimate);
+    stream.payloads.reserve(estimate);
+    stream.brackets.match.reserve(estimate);
+
+    const char* iter = str.data();
+    const char* const end = iter + str.length();
+    const char* begin = iter;
+    line_table lines(iter, stream.line_starts);
+
+    token_base t;
+    while (scan_token(iter, end, lines, t, begin))
+    {
+        const std::string_view literal(begin, iter - begin);
+        if (t.type == token_type::identifier)
+            t.symbol = symbols.intern(literal);
+
+        stream.push_back(t, uint32_t(begin - str.data()), uint32_t(literal.length()));
+        stream.brackets.push(t.type);
+        t = token_base();
+    }
+
+    return stream;
+}
+
+void compiler::tokenizer::tokenize_from(std::string_view str, size_t offset, size_t line, size_t line_begin, symbol_interner& symbols, const std::function<bool(token&, size_t)>& accept)
+{
+    const char* iter = str.data() + offset;
+    const char* const end = str.data() + str.length();
+    const char* begin = iter;
+
+    line_counter lines(str.data() + line_begin);
+    lines.line = line;
+
+    token t;
+    while (scan_token(iter, end, lines, t, begin))
+    {
+        std::tie(t.line, t.character) = lines.position(begin);
+
+        if (t.type == token_type::identifier || t.type == token_type::keyword || t.type == token_type::number_type)
+            t.literal = std::string_view(begin, iter - begin);
+
+        if (t.type == token_type::identifier)
+            t.symbol = symbols.intern(t.literal);
+
+        if (!accept(t, size_t(begin - str.data()))) return;
+        t = token();
+    }
+}
+
+compiler::token_reader::token_reader(std::string_view source, symbol_interner& symbols, size_t window_size) :
+    source(source), symbols(&symbols), iter(source.data()), line_begin(source.data()), window(std::max<size_t>(window_size, 2))
+{
+}
+
+void compiler::token_reader::scan_next() const
+{
+    const char* const end = source.data() + source.length();
+    const char* begin = iter;
+
+    line_counter lines(line_begin);
+    lines.line = line;
+
+    token t;
+    if (!tokenizer::scan_token(iter, end, lines, t, begin))
+    {
+        finished = true;
+        return;
+    }
+
+    std::tie(t.line, t.character) = lines.position(begin);
+    line = lines.line;
+    line_begin = lines.line_begin;
+
+    if (t.type == token_type::identifier || t.type == token_type::keyword || t.type == token_type::number_type)
+        t.literal = std::string_view(begin, iter - begin);
+
+    if (t.type == token_type::identifier)
+        t.symbol = symbols->intern(t.literal);
+
+    // 窗口已满时覆盖最旧的词元
+    if (window_count == window.size())
+    {
+        window_base++;
+        window_count--;
+    }
+
+    window[(window_base + window_count) % window.size()] = t;
+    window_count++;
+}
+
+bool compiler::token_reader::fill(size_t index) const
+{
+    while (index >= window_base + window_count && !finished)
+        scan_next();
+
+    return index < window_base + window_count;
+}
+
+token compiler::token_reader::at(size_t index) const
+{
+    if (!fill(index)) throw std::out_of_range("Token index out of range.");
+    if (index < window_base) throw std::logic_error("Token has already left the lookahead window.");
+
+    return window[index % window.size()];
+}
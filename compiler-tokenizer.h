@@ -3,6 +3,7 @@
 #pragma once
 
 #include "compiler-base.h"
+#include "compiler-token-stream.h"
 
 namespace compiler
 {
@@ -11,15 +12,80 @@ namespace compiler
 		using compiler_exception::compiler_exception; // 继承构造函数
 	};
 
+	class token_reader;
+
 	// 词元分析器包装类
 	class tokenizer
 	{
+		friend class token_reader;
+
 	private: // 辅助函数
 		static std::optional<std::tuple<number_union, size_t, number_type>> get_number(std::string_view input); // 提取数字常量
-		static std::optional<std::string_view> get_identifier(std::string_view input); // 提取单词（标识符/关键词）
-		static bool has_white_space(std::string_view view); // 视图首是否为空格
+
+		// 扫描单个词元（跳过前导空白），到达输入末尾时返回 false
+		template<class line_tracker>
+		static bool scan_token(const char*& iter, const char* end, line_tracker& lines, token_base& t, const char*& begin);
+
+		// 校验输入为合法 UTF-8，否则在首个非法字节处抛出 tokenizer_exception
+		static void validate_utf8(std::string_view str);
+
+		// 单线程扫描一段已通过 validate_utf8 的源码并追加到 list，返回其中的换行数
+		static size_t tokenize_into(std::string_view str, symbol_interner& symbols, std::vector<token>& list);
 
 	public:
-		static std::vector<token> tokenize(std::string_view str);
+		// 源码超过此长度且有多个硬件线程时并行词法分析
+		static constexpr size_t parallel_threshold = 4 << 20;
+
+		// 生成词元列表，字面量引用源码，标识符驻留于 symbols
+		// 输入须为 UTF-8，标识符可含 XID_Start/XID_Continue 字符；列号按字节计
+		static std::vector<token> tokenize(std::string_view str, symbol_interner& symbols);
+
+		// 生成词元列表并记录括号匹配表
+		static std::vector<token> tokenize(std::string_view str, symbol_interner& symbols, bracket_table& brackets);
+
+		// 在换行处切分为 chunk_count 段并行扫描后拼接，结果（含符号编号与异常位置）与单线程一致
+		static std::vector<token> tokenize_parallel(std::string_view str, symbol_interner& symbols, size_t chunk_count);
+
+		// 生成紧凑词元流，同时记录其括号匹配表
+		static token_stream tokenize_stream(std::string_view str, symbol_interner& symbols);
+
+		// 自 str 的 offset 处继续扫描（offset 须位于词元开头或空白中），offset 位于第 line 行，该行行首偏移为 line_begin
+		// 每个词元连同其起始偏移交给 accept，accept 返回 false 时停止；不做整体 UTF-8 预校验，非法序列在扫描到时报错
+		static void tokenize_from(std::string_view str, size_t offset, size_t line, size_t line_begin, symbol_interner& symbols, const std::function<bool(token&, size_t)>& accept);
+	};
+
+	// 拉取式词法分析器：解析器访问到哪里才扫描到哪里，只保留有界的前瞻窗口
+	// 提供与 token_list 相同的 at()，词元按值返回；内存占用与源码长度无关
+	// 解析器不回溯，窗口只需容纳单条语句内的前瞻，被移出窗口的词元不可再访问
+	// 不做整体 UTF-8 预校验，非法序列在扫描到时报错
+	class token_reader
+	{
+	private:
+		std::string_view source;
+		symbol_interner* symbols;
+
+		// 扫描状态
+		mutable const char* iter;
+		mutable size_t line = 0;
+		mutable const char* line_begin;
+		mutable bool finished = false;
+
+		// 环形窗口，容纳编号 [window_base, window_base + window_count) 的词元
+		mutable std::vector<token> window;
+		mutable size_t window_base = 0;
+		mutable size_t window_count = 0;
+
+		void scan_next() const;
+
+	public:
+		static constexpr size_t default_window_size = 64;
+
+		token_reader(std::string_view source, symbol_interner& symbols, size_t window_size = default_window_size);
+
+		// 编号为 index 的词元是否存在，必要时向前扫描
+		bool fill(size_t index) const;
+
+		// 取词元，越过输入末尾时抛出 std::out_of_range，访问已移出窗口的词元时抛出 std::logic_error
+		token at(size_t index) const;
 	};
 }
\ No newline at end of file
@@ -6,49 +6,51 @@ namespace compiler::visualization
 {
 	const char* operator_literals[] = { "NONE", "+", "-", "*", "/", "%", "!", "&", "|", "^", "<<", ">>", "==", "!=", ">", ">=", "<", "<=", "@", "=", ":" };
 
-	void print_node_value(node_value* node, size_t depth = 0)
+	void print_node_value(const syntax_tree& tree, node_index index, const symbol_interner& symbols, size_t depth = 0)
 	{
+		const auto& node = tree[index];
+
 		for (size_t i = 0; i < depth; i++)
 			printf("  ");
 
-		switch (node->node_type)
+		switch (node.node_type)
 		{
 		case node_value::node_constant:
 		{
-			switch (node->number_type)
+			switch (node.number_type)
 			{
 			case number_type::float_point:
-				printf("float(%f);\n", node->value.fp_number);
+				printf("float(%f);\n", node.value.fp_number);
 				break;
 
 			case number_type::integer:
-				printf("int(%d);\n", node->value.int_number);
+				printf("int(%d);\n", node.value.int_number);
 				break;
 
 			case number_type::unsigned_integer:
-				printf("uint(%u);\n", node->value.uint_number);
+				printf("uint(%u);\n", node.value.uint_number);
 				break;
 			}
 			break;
 		}
 
 		case node_value::node_identifier:
-			printf("identifier(\"%s\")\n", node->identifier.c_str());
+			printf("identifier(\"%.*s\")\n", int(symbols.name(node.identifier).length()), symbols.name(node.identifier).data());
 			break;
 
 		case node_value::node_operator:
-			printf("operator(%s):\n", operator_literals[int(node->op_type)]);
-			if(node->left) print_node_value(node->left, depth + 1);
-			if(node->right) print_node_value(node->right, depth + 1);
+			printf("operator(%s):\n", operator_literals[int(node.op_type)]);
+			if(node.left != invalid_node) print_node_value(tree, node.left, symbols, depth + 1);
+			if(node.right != invalid_node) print_node_value(tree, node.right, symbols, depth + 1);
 			break;
 
 		case node_value::node_function:
-			printf("func(\"%s\"):", node->identifier.c_str());
-			if (node->parameter_list.size())
+			printf("func(\"%.*s\"):", int(symbols.name(node.identifier).length()), symbols.name(node.identifier).data());
+			if (node.right != 0)
 			{
 				printf("\n");
-				for (auto x : node->parameter_list)
-					print_node_value(x, depth + 1);
+				for (auto x : tree.parameters_of(index))
+					print_node_value(tree, x, symbols, depth + 1);
 			}
 			else
 				printf(" ();\n");
@@ -56,4 +58,122 @@ namespace compiler::visualization
 		}
 	}
 
-}
\ No newline at end of file
+	const char* type_literals[] = { "none", "int", "uint", "float" };
+
+	const char* opcode_literals[] = { "nop", "const", "undef", "param", "binary", "unary", "convert", "load", "store", "load_global", "store_global", "call", "phi", "jump", "branch", "ret" };
+
+	void print_instruction(const ir::function& fn, ir::value_id id, const syntax_tree& tree, const symbol_interner& symbols)
+	{
+		const auto& inst = fn.values[id];
+
+		printf("    ");
+		if (inst.type != number_type::none) printf("%%%u = ", id);
+
+		switch (inst.code)
+		{
+		case ir::opcode::constant:
+		{
+			number_union value;
+			value.uint_number = inst.a;
+
+			if (inst.type == number_type::float_point) printf("const float %f\n", value.fp_number);
+			else if (inst.type == number_type::integer) printf("const int %d\n", value.int_number);
+			else printf("const uint %u\n", value.uint_number);
+			break;
+		}
+
+		case ir::opcode::binary:
+			printf("%s %s %%%u, %%%u\n", type_literals[int(inst.type)], operator_literals[int(inst.op)], inst.a, inst.b);
+			break;
+
+		case ir::opcode::unary:
+			printf("%s %s %%%u\n", type_literals[int(inst.type)], operator_literals[int(inst.op)], inst.a);
+			break;
+
+		case ir::opcode::parameter:
+			printf("param %s %u\n", type_literals[int(inst.type)], inst.a);
+			break;
+
+		case ir::opcode::convert:
+		case ir::opcode::load:
+			printf("%s %s %%%u\n", opcode_literals[int(inst.code)], type_literals[int(inst.type)], inst.a);
+			break;
+
+		case ir::opcode::store:
+			printf("store %%%u, %%%u\n", inst.a, inst.b);
+			break;
+
+		case ir::opcode::load_global:
+		case ir::opcode::store_global:
+		{
+			const auto name = symbols.name(tree.variables[inst.a].name);
+			printf("%s %.*s", opcode_literals[int(inst.code)], int(name.length()), name.data());
+			if (inst.code == ir::opcode::store_global) printf(", %%%u", inst.b);
+			printf("\n");
+			break;
+		}
+
+		case ir::opcode::call:
+		case ir::opcode::phi:
+		{
+			if (inst.code == ir::opcode::call)
+				printf("call %s %.*s(", type_literals[int(inst.type)], int(symbols.name(inst.a).length()), symbols.name(inst.a).data());
+			else
+				printf("phi %s (", type_literals[int(inst.type)]);
+
+			const auto uses = fn.operands_of(id);
+			for (size_t i = 0; i < uses.size(); i++)
+			{
+				if (inst.code == ir::opcode::phi)
+					printf(i ? ", b%u: %%%u" : "b%u: %%%u", fn.blocks[inst.block].predecessors[i], uses[i]);
+				else
+					printf(i ? ", %%%u" : "%%%u", uses[i]);
+			}
+			printf(")\n");
+			break;
+		}
+
+		case ir::opcode::jump:
+			printf("jump b%u\n", inst.a);
+			break;
+
+		case ir::opcode::branch:
+			printf("branch %%%u, b%u, b%u\n", inst.a, inst.b, inst.c);
+			break;
+
+		case ir::opcode::ret:
+			if (inst.a == ir::no_value) printf("ret\n");
+			else printf("ret %%%u\n", inst.a);
+			break;
+
+		default:
+			printf("%s %s\n", opcode_literals[int(inst.code)], type_literals[int(inst.type)]);
+			break;
+		}
+	}
+
+	void print_function(const ir::function& fn, const syntax_tree& tree, const symbol_interner& symbols)
+	{
+		const auto name = symbols.name(fn.name);
+		printf("func %.*s(%u) -> %s:\n", int(name.length()), name.data(), fn.parameter_count, type_literals[int(fn.return_type)]);
+
+		for (ir::block_id b = 0; b < fn.blocks.size(); b++)
+		{
+			const auto& block = fn.blocks[b];
+
+			printf("  b%u:", b);
+			if (!block.predecessors.empty())
+			{
+				printf(" ; preds");
+				for (auto predecessor : block.predecessors)
+					printf(" b%u", predecessor);
+			}
+			printf("\n");
+
+			for (auto id : block.phis)
+				print_instruction(fn, id, tree, symbols);
+			for (auto id : block.code)
+				print_instruction(fn, id, tree, symbols);
+		}
+	}
+}
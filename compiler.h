@@ -3,5 +3,15 @@
 #pragma once
 
 #include "compiler-base.h"
+#include "compiler-token-stream.h"
+#include "compiler-source-file.h"
 #include "compiler-tokenizer.h"
-#include "compiler-syntax-parser.h"
\ No newline at end of file
+#include "compiler-constant-folding.h"
+#include "compiler-syntax-parser.h"
+#include "compiler-incremental.h"
+#include "compiler-ir.h"
+#include "compiler-pass-manager.h"
+#include "compiler-dead-code.h"
+#include "compiler-simplify.h"
+#include "compiler-loops.h"
+#include "compiler-gvn.h"
\ No newline at end of file
@@ -0,0 +1,195 @@
+﻿// ez-lang-benchmark.cpp: 数字常量词法分析的基准测试，以旧版基于正则表达式的识别为对照
+
+#include "compiler.h"
+
+#include <regex> // 仅对照实现使用，编译器本身不再依赖
+
+// 旧版的数字常量识别：截取候选字符后拷贝为字符串，逐个正则匹配并以 C 库函数转换
+namespace regex_reference
+{
+	const std::regex hex_regex{ "^0x([0-9A-Fa-f]+)$" }; // 十六进制
+	const std::regex unsigned_dec_regex{ "^([0-9]+)[Uu]$" }; // 无符号十进制
+	const std::regex signed_dec_regex{ "^([0-9]+)$" }; // 有符号十进制，不带符号
+	const std::regex float_regex{ "^([0-9]*\\.[0-9]+)f?$" }; // 浮点，不带符号
+
+	static std::optional<std::tuple<compiler::number_union, size_t, compiler::number_type>> get_number(std::string_view input)
+	{
+		size_t len = 0;
+		while ((input[len] >= '0' && input[len] <= '9')
+			|| (input[len] == 'x' && len == 1)
+			|| input[len] == 'u'
+			|| input[len] == '.'
+			|| input[len] == 'f'
+			|| (input[len] == '-' && len == 0))
+		{
+			len++;
+			if (len >= input.length()) break;
+		}
+
+		std::string number_string{ input.substr(0, len) };
+		compiler::number_union ret;
+
+		if (std::regex_match(number_string, hex_regex))
+		{
+			std::string match = std::regex_replace(number_string, hex_regex, "$1");
+			ret.uint_number = strtoul(match.c_str(), nullptr, 16);
+			return std::tuple(ret, len, compiler::number_type::unsigned_integer);
+		}
+
+		if (std::regex_match(number_string, unsigned_dec_regex))
+		{
+			std::string match = std::regex_replace(number_string, unsigned_dec_regex, "$1");
+			ret.uint_number = strtoul(match.c_str(), nullptr, 10);
+			return std::tuple(ret, len, compiler::number_type::unsigned_integer);
+		}
+
+		if (std::regex_match(number_string, float_regex))
+		{
+			std::string match = std::regex_replace(number_string, float_regex, "$1");
+			ret.fp_number = strtof(match.c_str(), nullptr);
+			return std::tuple(ret, len, compiler::number_type::float_point);
+		}
+
+		if (std::regex_match(number_string, signed_dec_regex))
+		{
+			std::string match = std::regex_replace(number_string, signed_dec_regex, "$1");
+			ret.int_number = atoi(match.c_str());
+			return std::tuple(ret, len, compiler::number_type::integer);
+		}
+
+		return std::nullopt;
+	}
+
+	// 跳过空白逐个识别 source 中的常量，结果追加到 values
+	static bool scan(std::string_view source, std::vector<std::pair<compiler::number_union, compiler::number_type>>& values)
+	{
+		for (size_t pos = 0; pos < source.size();)
+		{
+			if (source[pos] == ' ' || source[pos] == '\n')
+			{
+				pos++;
+				continue;
+			}
+
+			const auto number = get_number(source.substr(pos));
+			if (!number) return false;
+
+			values.emplace_back(std::get<0>(*number), std::get<2>(*number));
+			pos += std::get<1>(*number);
+		}
+
+		return true;
+	}
+}
+
+// 生成 count 个以空白分隔的数字常量：十进制、十六进制、无符号与浮点各占四分之一，以固定种子生成，结果可复现
+static std::string generate_literals(size_t count)
+{
+	std::string source;
+	source.reserve(count * 8);
+
+	uint64_t seed = 0x2545F4914F6CDD1Dull;
+	auto next = [&]()
+	{
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		return seed;
+	};
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint64_t value = next();
+
+		switch (i % 4)
+		{
+		case 0: source += std::format("{}", value % 1000000); break;
+		case 1: source += std::format("0x{}", value % 10000000); break; // 词法分析器的候选字符中十六进制字母只有 f
+		case 2: source += std::format("{}u", value % 100000); break;
+		default: source += std::format("{}.{}f", value % 1000, value % 100); break;
+		}
+
+		source += (i % 16 == 15) ? '\n' : ' ';
+	}
+
+	return source;
+}
+
+// 用法：ez-lang-benchmark [常量个数=500000] [重复次数=5]
+// 分别输出对照实现与词法分析器最快一次的耗时与吞吐量；词法分析器一侧为完整的词法分析，包含空白、行列与词元的记录
+int main(int argc, char* argv[])
+{
+	size_t count = 500000, runs = 5;
+
+	auto read_option = [&](int i, size_t& value)
+	{
+		const std::string_view option = argv[i];
+		std::from_chars(option.data(), option.data() + option.size(), value);
+	};
+
+	if (argc > 1) read_option(1, count);
+	if (argc > 2) read_option(2, runs);
+
+	const auto source = generate_literals(count);
+	runs = std::max<size_t>(runs, 1);
+
+	// 最快一次的耗时，单位为秒
+	auto measure = [&](const auto& body)
+	{
+		double best = std::numeric_limits<double>::max();
+
+		for (size_t run = 0; run < runs; run++)
+		{
+			const auto begin = std::chrono::steady_clock::now();
+			body();
+			const auto end = std::chrono::steady_clock::now();
+
+			best = std::min(best, std::chrono::duration<double>(end - begin).count());
+		}
+
+		return best;
+	};
+
+	std::vector<std::pair<compiler::number_union, compiler::number_type>> reference;
+	std::vector<compiler::token> list;
+	bool scanned = true;
+
+	const double regex_time = measure([&]
+		{
+			reference.clear();
+			reference.reserve(count);
+			scanned = regex_reference::scan(source, reference);
+		});
+
+	const double scanner_time = measure([&]
+		{
+			compiler::symbol_interner symbols;
+			list = compiler::tokenizer::tokenize(source, symbols);
+		});
+
+	// 两侧须对每个常量得到相同的类型与数值
+	if (!scanned || reference.size() != count || list.size() != count)
+	{
+		std::cerr << std::format("Unexpected results: {0} reference values, {1} tokens, {2} expected.", reference.size(), list.size(), count) << std::endl;
+		return 1;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		if (list[i].type != compiler::token_type::number || list[i].number_type != reference[i].second || list[i].number_data.uint_number != reference[i].first.uint_number)
+		{
+			std::cerr << std::format("Literal {0} differs from the reference.", i) << std::endl;
+			return 1;
+		}
+
+	auto print = [&](const char* name, double time)
+	{
+		std::cout << std::format("{0}: {1:.2f} ms, {2:.2f}M literals/s, {3:.1f} MB/s", name, time * 1e3, count / time / 1e6, source.size() / time / 1e6) << std::endl;
+	};
+
+	std::cout << std::format("{0} literals, {1:.2f} MB", count, source.size() / 1e6) << std::endl;
+	print("regex reference", regex_time);
+	print("tokenizer", scanner_time);
+	std::cout << std::format("speedup: {0:.1f}x", regex_time / scanner_time) << std::endl;
+
+	return 0;
+}
@@ -1,16 +1,222 @@
 ﻿#include "compiler.h"
 #include "compiler-visualize.hpp"
 
-int main()
+// 输出一条错误，有位置时带上行列
+static void report_error(const compiler::compiler_exception& error)
 {
+	if (error.pos_available)
+		std::cerr << std::format("Line {0}, Character {1}: {2}", error.line, error.character, error.msg) << std::endl;
+	else
+		std::cerr << error.msg << std::endl;
+}
+
+// 输出全部语法错误，有错误时返回 false
+static bool report_diagnostics(const compiler::parse_context& context)
+{
+	for (const auto& error : context.diagnostics)
+		report_error(error);
+
+	return context.diagnostics.empty();
+}
+
+// 增量模式：以源文件建立增量文档，自标准输入逐行读取编辑并应用，输出每次编辑的工作量与诊断
+// 每行为 "偏移 删除长度 插入文本"，偏移与长度按字节计；插入文本中 \n、\t、\\ 分别表示换行、制表符与反斜杠
+// 最后一次编辑后无诊断时返回 0
+static int run_incremental(std::string_view text)
+{
+	compiler::incremental_document document{ std::string(text) };
+
+	auto report_document = [&]()
+	{
+		const auto diagnostics = document.diagnostics();
+		for (const auto& error : diagnostics)
+			report_error(error);
+
+		return diagnostics.empty();
+	};
+
+	bool clean = report_document();
+	std::string line;
+
+	for (size_t count = 1; std::getline(std::cin, line); count++)
+	{
+		// 解析偏移与删除长度
+		compiler::text_edit edit;
+		const char* iter = line.data();
+		const char* const end = iter + line.size();
+
+		auto read_number = [&](size_t& value)
+		{
+			const auto [ptr, ec] = std::from_chars(iter, end, value);
+			if (ec != std::errc()) return false;
+
+			iter = ptr;
+			if (iter != end && *iter == ' ') iter++;
+			return true;
+		};
+
+		if (!read_number(edit.offset) || !read_number(edit.removed))
+		{
+			std::cerr << std::format("Edit {0}: expected \"offset removed text\".", count) << std::endl;
+			clean = false;
+			continue;
+		}
+
+		// 还原转义字符
+		std::string inserted;
+		for (; iter != end; iter++)
+		{
+			if (*iter == '\\' && iter + 1 != end)
+			{
+				const char next = *++iter;
+				inserted += next == 'n' ? '\n' : next == 't' ? '\t' : next;
+			}
+			else
+				inserted += *iter;
+		}
+
+		edit.inserted = inserted;
+
+		try
+		{
+			document.apply(edit);
+		}
+		catch (const compiler::compiler_exception& e)
+		{
+			report_error(e);
+			clean = false;
+			continue;
+		}
+
+		const auto& statistics = document.statistics();
+		std::cout << std::format("Edit {0}: relexed {1} tokens, reparsed {2} items{3}", count, statistics.relexed_tokens, statistics.reparsed_items, statistics.full_rebuild ? ", full rebuild" : "") << std::endl;
+
+		clean = report_document();
+	}
+
+	return clean ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	compiler::parse_context context;
+	size_t iter = 0;
+
+	// 指定源文件时解析整个程序：函数体先跳过，只解析自 main 可达的函数（--stream 时全部解析），再解析其中的名称并降低为 SSA 形式
+	if (argc > 1)
+	{
+		// 名称与词元字面量指向映射内存，映射须先于符号表构造、晚于其析构
+		std::optional<compiler::source_file> source;
+
+		try
+		{
+			source.emplace(argv[1]);
+		}
+		catch (const compiler::compiler_exception& e)
+		{
+			report_error(e);
+			return 1;
+		}
+
+		compiler::symbol_interner symbols;
+		compiler::token_stream stream;
+
+		// 选项：--ir 输出优化后的 SSA 形式，--stream 以拉取式词法分析边扫描边解析，--time-passes 输出各 pass 的耗时，--unroll-budget=N 设置循环展开的指令数上限
+		// --incremental 进入增量模式，只做词法与语法分析
+		bool print_ir = false, time_passes = false, stream_tokens = false, incremental = false;
+
+		for (int i = 2; i < argc; i++)
+		{
+			const std::string_view option = argv[i];
+			constexpr std::string_view unroll_option = "--unroll-budget=";
+
+			if (option == "--ir") print_ir = true;
+			else if (option == "--time-passes") time_passes = true;
+			else if (option == "--stream") stream_tokens = true;
+			else if (option == "--incremental") incremental = true;
+			else if (option.starts_with(unroll_option))
+			{
+				const auto value = option.substr(unroll_option.size());
+				std::from_chars(value.data(), value.data() + value.size(), compiler::ir::unroll_budget);
+			}
+		}
+
+		if (incremental)
+			return run_incremental(source->view());
+
+		// 词法错误无法恢复，输出后直接结束
+		try
+		{
+			if (stream_tokens)
+			{
+				// 拉取式：词元内存与文件大小无关，但无法回头，全部函数体随即解析
+				compiler::token_reader reader(source->view(), symbols);
+				compiler::statement_parser::parse_program(reader, iter, context);
+			}
+			else
+			{
+				stream = compiler::tokenizer::tokenize_stream(source->view(), symbols);
+				context.brackets = &stream.brackets;
+
+				compiler::statement_parser::parse_program(stream, iter, context);
+			}
+		}
+		catch (const compiler::tokenizer_exception& e)
+		{
+			report_error(e);
+			return 1;
+		}
+
+		if (auto entry = symbols.lut.find("main"); entry == symbols.lut.end())
+			context.diagnostics.emplace_back("No \"main\" function found.");
+		else if (!stream_tokens)
+			compiler::statement_parser::parse_reachable_functions(stream, context, entry->second);
+
+		compiler::statement_parser::resolve_program(context, symbols);
+
+		if (!report_diagnostics(context)) return 1;
+
+		// 无错误时降低为 SSA 形式，再逐个函数运行优化 pass
+		auto program = compiler::ir::lower_program(context.tree);
+		compiler::ir::remove_unread_globals(program);
+
+		compiler::ir::pass_manager passes;
+		passes.add(compiler::ir::prune_branches_pass);
+		passes.add(compiler::ir::simplify_pass);
+		passes.add(compiler::ir::hoist_invariants_pass);
+		passes.add(compiler::ir::unroll_loops_pass);
+		passes.add(compiler::ir::prune_branches_pass);
+		passes.add(compiler::ir::simplify_pass);
+		passes.add(compiler::ir::value_numbering_pass);
+		passes.add(compiler::ir::dead_code_pass);
+		passes.run(program);
+
+		if (print_ir)
+			for (const auto& function : program.functions)
+				compiler::visualization::print_function(function, context.tree, symbols);
+
+		if (time_passes)
+			passes.report(std::cerr);
+
+		return 0;
+	}
+
+	compiler::symbol_interner symbols;
+
 	std::string test;
 	std::getline(std::cin, test);
 
-	auto tokenlist = compiler::tokenizer::tokenize(test);
-
-	size_t iter = 0;	
-	
-	auto parse = compiler::statement_parser::parse_if_branch(tokenlist, iter);
+	// 单条语句无需跳过语句块，边扫描边解析
+	try
+	{
+		compiler::token_reader reader(test, symbols);
+		compiler::statement_parser::parse_if_branch(reader, iter, context);
+	}
+	catch (const compiler::tokenizer_exception& e)
+	{
+		report_error(e);
+		return 1;
+	}
 
-	return 0;
+	return report_diagnostics(context) ? 0 : 1;
 }
\ No newline at end of file